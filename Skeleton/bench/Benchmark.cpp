@@ -0,0 +1,251 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using std::unique_ptr;
+
+const int64_t BenchmarkState::MAX_ITERATIONS;
+
+BenchmarkState::BenchmarkState(int64_t argument, double minTime)
+    : arg(argument), minTime(minTime), started(false), paused(false), completed(0), nextCheck(1),
+      realStart(0), cpuStart(0), realTotal(0), cpuTotal(0), items(0), labelText() {}
+
+double BenchmarkState::realNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double BenchmarkState::cpuNow() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// The clock is only read at checkpoints, each twice as many iterations in as the last, so
+// reading it costs next to nothing even for the shortest loop bodies
+bool BenchmarkState::keepRunning() {
+    if (!started) {
+        started = true;
+        resumeTiming();
+        return true;
+    }
+    if (++completed < nextCheck) {
+        return true;
+    }
+    double elapsed = realTotal + (paused ? 0 : realNow() - realStart);
+    if (elapsed >= minTime || completed >= MAX_ITERATIONS) {
+        if (!paused) {
+            pauseTiming();
+        }
+        return false;
+    }
+    nextCheck = completed * 2;
+    return true;
+}
+
+int64_t BenchmarkState::argument() const {
+    return arg;
+}
+
+void BenchmarkState::pauseTiming() {
+    realTotal += realNow() - realStart;
+    cpuTotal += cpuNow() - cpuStart;
+    paused = true;
+}
+
+void BenchmarkState::resumeTiming() {
+    paused = false;
+    cpuStart = cpuNow();
+    realStart = realNow();
+}
+
+void BenchmarkState::setItemsProcessed(int64_t items) {
+    this->items = items;
+}
+
+void BenchmarkState::setLabel(const string &label) {
+    labelText = label;
+}
+
+int64_t BenchmarkState::iterations() const {
+    return completed;
+}
+
+double BenchmarkState::realTime() const {
+    return realTotal;
+}
+
+double BenchmarkState::cpuTime() const {
+    return cpuTotal;
+}
+
+int64_t BenchmarkState::itemsProcessed() const {
+    return items;
+}
+
+const string &BenchmarkState::label() const {
+    return labelText;
+}
+
+Benchmark::Benchmark(const string &name, BenchmarkFunction function) : name(name), function(function), arguments() {}
+
+Benchmark *Benchmark::arg(int64_t argument) {
+    arguments.push_back(argument);
+    return this;
+}
+
+Benchmark *Benchmark::range(int64_t low, int64_t high, int64_t multiplier) {
+    for (int64_t argument = low; argument < high; argument *= multiplier) {
+        arguments.push_back(argument);
+    }
+    arguments.push_back(high);
+    return this;
+}
+
+const string &Benchmark::getName() const {
+    return name;
+}
+
+BenchmarkFunction Benchmark::getFunction() const {
+    return function;
+}
+
+const vector<int64_t> &Benchmark::getArguments() const {
+    return arguments;
+}
+
+static vector<unique_ptr<Benchmark>> &registeredBenchmarks() {
+    static vector<unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+Benchmark *registerBenchmark(const string &name, BenchmarkFunction function) {
+    registeredBenchmarks().emplace_back(new Benchmark(name, function));
+    return registeredBenchmarks().back().get();
+}
+
+// One finished run, times per iteration in nanoseconds
+struct BenchmarkResult {
+    BenchmarkResult() : name(), iterations(0), realTime(0), cpuTime(0), itemsPerSecond(0), label() {}
+    string name;
+    int64_t iterations;
+    double realTime, cpuTime;
+    double itemsPerSecond; //0 if the benchmark counts no items
+    string label;
+};
+
+static string jsonString(const string &text) {
+    string result = "\"";
+    for (char character : text) {
+        if (character == '"' || character == '\\') {
+            result += '\\';
+        }
+        result += character;
+    }
+    return result + "\"";
+}
+
+static void writeJson(const string &path, const char *executable, const vector<BenchmarkResult> &results) {
+    char hostName[256] = "";
+    gethostname(hostName, sizeof(hostName) - 1);
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    std::ofstream out(path);
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": " << jsonString(date) << ",\n"
+        << "    \"host_name\": " << jsonString(hostName) << ",\n"
+        << "    \"executable\": " << jsonString(executable) << ",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &result = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\n"
+            << "      \"name\": " << jsonString(result.name) << ",\n"
+            << "      \"run_name\": " << jsonString(result.name) << ",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << result.realTime << ",\n"
+            << "      \"cpu_time\": " << result.cpuTime << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        if (result.itemsPerSecond > 0) {
+            out << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+        }
+        if (!result.label.empty()) {
+            out << ",\n      \"label\": " << jsonString(result.label);
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int runBenchmarks(int argc, char **argv) {
+    string filter = ".*";
+    string outPath;
+    double minTime = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag.compare(0, 19, "--benchmark_filter=") == 0) {
+            filter = flag.substr(19);
+        } else if (flag.compare(0, 21, "--benchmark_min_time=") == 0) {
+            minTime = atof(flag.c_str() + 21);
+        } else if (flag.compare(0, 16, "--benchmark_out=") == 0) {
+            outPath = flag.substr(16);
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    std::regex pattern(filter);
+
+    printf("%-48s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    printf("%s\n", string(93, '-').c_str());
+    vector<BenchmarkResult> results;
+    for (const unique_ptr<Benchmark> &benchmark : registeredBenchmarks()) {
+        vector<int64_t> arguments = benchmark->getArguments();
+        bool hasArguments = !arguments.empty();
+        if (!hasArguments) {
+            arguments.push_back(0);
+        }
+        for (int64_t argument : arguments) {
+            BenchmarkResult result;
+            result.name = benchmark->getName() + (hasArguments ? "/" + std::to_string(argument) : "");
+            if (!std::regex_search(result.name, pattern)) {
+                continue;
+            }
+            BenchmarkState state(argument, minTime);
+            benchmark->getFunction()(state);
+            int64_t iterations = std::max<int64_t>(state.iterations(), 1);
+            result.iterations = state.iterations();
+            result.realTime = state.realTime() * 1e9 / iterations;
+            result.cpuTime = state.cpuTime() * 1e9 / iterations;
+            result.itemsPerSecond = state.realTime() > 0 ? state.itemsProcessed() / state.realTime() : 0;
+            result.label = state.label();
+            printf("%-48s %12.0f ns %12.0f ns %12lld", result.name.c_str(), result.realTime, result.cpuTime,
+                   static_cast<long long>(result.iterations));
+            if (result.itemsPerSecond > 0) {
+                printf(" %10.4g items/s", result.itemsPerSecond);
+            }
+            printf("%s%s\n", result.label.empty() ? "" : " ", result.label.c_str());
+            fflush(stdout);
+            results.push_back(result);
+        }
+    }
+    if (!outPath.empty()) {
+        writeJson(outPath, argv[0], results);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// A small benchmark harness in the style of Google Benchmark, so the suite builds with nothing
+// but the compiler. Benchmarks register with BENCHMARK, time their loop body with
+// `while (state.keepRunning())`, and are run by runBenchmarks, which prints a table and can
+// write the results as JSON in Google Benchmark's format.
+class BenchmarkState {
+    public:
+        BenchmarkState(int64_t argument, double minTime);
+        // True while more iterations are wanted: until minTime seconds have been timed.
+        // Times everything between the first call and the last, except paused stretches.
+        bool keepRunning();
+        int64_t argument() const; //The argument this run was registered with
+        void pauseTiming(); //For setup work inside the loop
+        void resumeTiming();
+        void setItemsProcessed(int64_t items); //Reported as items_per_second
+        void setLabel(const string &label);
+        int64_t iterations() const;
+        double realTime() const; //Seconds timed
+        double cpuTime() const; //CPU seconds of the whole process, all threads, while timed
+        int64_t itemsProcessed() const;
+        const string &label() const;
+
+        static const int64_t MAX_ITERATIONS = 1000000000;
+
+    private:
+        static double realNow();
+        static double cpuNow();
+        const int64_t arg;
+        const double minTime;
+        bool started;
+        bool paused;
+        int64_t completed;
+        int64_t nextCheck;
+        double realStart, cpuStart; //Start of the current timed stretch
+        double realTotal, cpuTotal; //Earlier timed stretches
+        int64_t items;
+        string labelText;
+};
+
+// Keeps the compiler from optimizing away the computation of value
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "g"(value) : "memory");
+}
+
+typedef void (*BenchmarkFunction)(BenchmarkState &state);
+
+class Benchmark {
+    public:
+        Benchmark(const string &name, BenchmarkFunction function);
+        Benchmark *arg(int64_t argument);
+        // low, then each multiple of multiplier up to high, and high itself
+        Benchmark *range(int64_t low, int64_t high, int64_t multiplier = 8);
+        const string &getName() const;
+        BenchmarkFunction getFunction() const;
+        const vector<int64_t> &getArguments() const;
+
+    private:
+        string name;
+        BenchmarkFunction function;
+        vector<int64_t> arguments;
+};
+
+Benchmark *registerBenchmark(const string &name, BenchmarkFunction function);
+
+// Runs the registered benchmarks. Flags, as in Google Benchmark:
+//   --benchmark_filter=<regex>   runs only the benchmarks whose name/argument matches
+//   --benchmark_min_time=<s>     time each benchmark for at least this long (default 0.5)
+//   --benchmark_out=<path>       also writes the results to path as JSON
+int runBenchmarks(int argc, char **argv);
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function) \
+    static Benchmark *BENCHMARK_CONCAT(benchmark_, __LINE__) = registerBenchmark(#function, function)
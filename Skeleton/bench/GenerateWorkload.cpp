@@ -0,0 +1,36 @@
+#include "Workload.h"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+// generate_workload <path> [plans] [settlements] [facilities] [seed]
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 6) {
+        fprintf(stderr, "usage: generate_workload <path> [plans] [settlements] [facilities] [seed]\n");
+        return 1;
+    }
+    WorkloadShape shape;
+    if (argc > 2) {
+        shape.plans = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        shape.settlements = atoi(argv[3]);
+    }
+    if (argc > 4) {
+        shape.facilities = atoi(argv[4]);
+    }
+    if (argc > 5) {
+        shape.seed = static_cast<unsigned>(strtoul(argv[5], nullptr, 10));
+    }
+    if (shape.plans < 0 || shape.settlements < 1 || shape.facilities < 0) {
+        fprintf(stderr, "Need at least one settlement, and no negative counts\n");
+        return 1;
+    }
+    try {
+        writeWorkload(argv[1], shape);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "OutputWriter.h"
+#include "Simulation.h"
+#include "Workload.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+Simulation* backup = nullptr;
+
+// write() calls made by this process so far, from /proc/self/io
+static long writeSyscalls() {
+    ifstream io("/proc/self/io");
+    string key;
+    long value;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            return value;
+        }
+    }
+    return -1;
+}
+
+// The printStatus of the previous release: four std::endl flushes per plan
+static void printStatusLegacy(const Plan &plan) {
+    cout << plan.toString() << endl;
+    cout << "Life Quality Score: " << plan.getLifeQualityScore() << endl;
+    cout << "Economy Score: " << plan.getEconomyScore() << endl;
+    cout << "Environment Score: " << plan.getEnvironmentScore() << endl;
+}
+
+static void report(const char *name, int plans, double seconds, long syscalls) {
+    cerr << name << ": " << plans << " plans in " << seconds * 1000 << " ms, " << syscalls << " write calls" << endl;
+}
+
+int main(int argc, char **argv) {
+    int plans = argc > 1 ? atoi(argv[1]) : 100000;
+    WorkloadShape shape;
+    shape.plans = plans;
+    shape.settlements = plans / 100 + 1;
+    shape.facilities = 12;
+    string path = temporaryWorkload(shape);
+    Simulation simulation(path);
+    remove(path.c_str());
+
+    // Output goes to /dev/null so the terminal does not dominate the timings; results go to cerr
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+    ios::sync_with_stdio(false);
+
+    long before = writeSyscalls();
+    auto start = chrono::steady_clock::now();
+    for (int id = 0; id < plans; ++id) {
+        printStatusLegacy(simulation.getPlan(id));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report("std::cout with std::endl", plans, seconds, writeSyscalls() - before);
+
+    const OutputFormat formats[] = {OutputFormat::TEXT, OutputFormat::JSON};
+    for (OutputFormat format : formats) {
+        standardOutput().setFormat(format);
+        before = writeSyscalls();
+        start = chrono::steady_clock::now();
+        for (int id = 0; id < plans; ++id) {
+            simulation.getPlanStatus(id);
+        }
+        standardOutput().flush();
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        report(format == OutputFormat::TEXT ? "OutputWriter, text" : "OutputWriter, json", plans, seconds, writeSyscalls() - before);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "Benchmark.h"
+#include "Workload.h"
+#include "FacilityCatalog.h"
+#include "Plan.h"
+#include "SelectionPolicy.h"
+#include "Settlement.h"
+#include "Simulation.h"
+#include <cstdio>
+#include <memory>
+#include <random>
+
+using std::unique_ptr;
+
+Simulation* backup = nullptr;
+
+static const int64_t MIN_PLANS = 1000;
+static const int64_t MAX_PLANS = 1000000;
+
+// count facility types of random category, cost 1 to 5 and impacts 0 to 5
+static FacilityCatalog randomCatalog(int count) {
+    FacilityCatalog catalog;
+    std::mt19937 random(1);
+    auto uniform = [&](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(random);
+    };
+    for (int i = 0; i < count; ++i) {
+        catalog.add(FacilityType("Facility" + std::to_string(i), static_cast<FacilityCategory>(i % 3),
+                                 uniform(1, 5), uniform(0, 5), uniform(0, 5), uniform(0, 5)));
+    }
+    return catalog;
+}
+
+// A running simulation of the given number of plans, built from a generated workload
+static unique_ptr<Simulation> runningSimulation(int64_t plans) {
+    WorkloadShape shape;
+    shape.plans = static_cast<int>(plans);
+    shape.settlements = static_cast<int>(plans / 10 + 1);
+    string path = temporaryWorkload(shape);
+    unique_ptr<Simulation> simulation(new Simulation(path));
+    std::remove(path.c_str());
+    simulation->open();
+    return simulation;
+}
+
+// One plan stepped a tick at a time; the argument is its SettlementType, which sets how many
+// facilities it builds at once
+static void BM_PlanStep(BenchmarkState &state) {
+    static const char *TYPE_NAMES[] = {"village", "city", "metropolis"};
+    FacilityCatalog catalog = randomCatalog(64);
+    Settlement settlement("Settlement", static_cast<SettlementType>(state.argument()));
+    Plan plan(0, settlement, new BalancedSelection(0, 0, 0));
+    Tick now = 0;
+    while (state.keepRunning()) {
+        plan.step(catalog, ++now);
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setLabel(TYPE_NAMES[state.argument()]);
+}
+BENCHMARK(BM_PlanStep)->arg(0)->arg(1)->arg(2);
+
+// One selection after another from a catalog of argument facility types
+static void selectFacility(BenchmarkState &state, SelectionPolicy *policy) {
+    unique_ptr<SelectionPolicy> owned(policy);
+    FacilityCatalog catalog = randomCatalog(static_cast<int>(state.argument()));
+    while (state.keepRunning()) {
+        doNotOptimize(policy->selectFacility(catalog));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+static void BM_SelectNaive(BenchmarkState &state) {
+    selectFacility(state, new NaiveSelection());
+}
+BENCHMARK(BM_SelectNaive)->range(8, 32768);
+
+static void BM_SelectBalanced(BenchmarkState &state) {
+    selectFacility(state, new BalancedSelection(0, 0, 0));
+}
+BENCHMARK(BM_SelectBalanced)->range(8, 32768);
+
+// The first selection of a new balanced policy, which has to scan the whole catalog
+static void BM_SelectBalancedFirst(BenchmarkState &state) {
+    FacilityCatalog catalog = randomCatalog(static_cast<int>(state.argument()));
+    while (state.keepRunning()) {
+        BalancedSelection policy(0, 0, 0);
+        doNotOptimize(policy.selectFacility(catalog));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SelectBalancedFirst)->range(8, 32768);
+
+static void BM_SelectEconomy(BenchmarkState &state) {
+    selectFacility(state, new EconomySelection());
+}
+BENCHMARK(BM_SelectEconomy)->range(8, 32768);
+
+static void BM_SelectSustainability(BenchmarkState &state) {
+    selectFacility(state, new SustainabilitySelection());
+}
+BENCHMARK(BM_SelectSustainability)->range(8, 32768);
+
+// One step of every plan
+static void BM_SimulationStep(BenchmarkState &state) {
+    unique_ptr<Simulation> simulation = runningSimulation(state.argument());
+    while (state.keepRunning()) {
+        simulation->step(1);
+    }
+    state.setItemsProcessed(state.iterations() * state.argument());
+}
+BENCHMARK(BM_SimulationStep)->range(MIN_PLANS, MAX_PLANS, 10);
+
+// Loading a generated configuration file of argument plans, on one thread and on the default
+// number; items are configuration lines
+static void loadConfig(BenchmarkState &state, int threadCount) {
+    WorkloadShape shape;
+    shape.plans = static_cast<int>(state.argument());
+    shape.settlements = shape.plans;
+    shape.facilities = shape.plans / 10;
+    string path = temporaryWorkload(shape);
+    while (state.keepRunning()) {
+        Simulation simulation(path, threadCount);
+    }
+    std::remove(path.c_str());
+    state.setItemsProcessed(state.iterations() * workloadLines(shape));
+    state.setLabel(std::to_string(threadCount) + " thread(s)");
+}
+
+static void BM_ConfigLoadSerial(BenchmarkState &state) {
+    loadConfig(state, 1);
+}
+BENCHMARK(BM_ConfigLoadSerial)->range(MIN_PLANS, MAX_PLANS, 10);
+
+static void BM_ConfigLoadParallel(BenchmarkState &state) {
+    loadConfig(state, ThreadPool::defaultThreadCount());
+}
+BENCHMARK(BM_ConfigLoadParallel)->range(MIN_PLANS, MAX_PLANS, 10);
+
+// Deletes the global backup after a benchmark, so the next one doesn't time its deletion
+static void deleteBackup() {
+    delete backup;
+    backup = nullptr;
+}
+
+static void BM_Backup(BenchmarkState &state) {
+    unique_ptr<Simulation> simulation = runningSimulation(state.argument());
+    simulation->step(3);
+    while (state.keepRunning()) {
+        simulation->backup();
+    }
+    deleteBackup();
+}
+BENCHMARK(BM_Backup)->range(MIN_PLANS, MAX_PLANS, 10);
+
+static void BM_Restore(BenchmarkState &state) {
+    unique_ptr<Simulation> simulation = runningSimulation(state.argument());
+    simulation->step(3);
+    simulation->backup();
+    while (state.keepRunning()) {
+        simulation->restore();
+    }
+    deleteBackup();
+}
+BENCHMARK(BM_Restore)->range(MIN_PLANS, MAX_PLANS, 10);
+
+// A step between backup and restore, so the step pays for copying what the backup shares
+static void BM_BackupStepRestore(BenchmarkState &state) {
+    unique_ptr<Simulation> simulation = runningSimulation(state.argument());
+    simulation->step(3);
+    while (state.keepRunning()) {
+        simulation->backup();
+        simulation->step(1);
+        simulation->restore();
+    }
+    state.setItemsProcessed(state.iterations() * state.argument());
+    deleteBackup();
+}
+BENCHMARK(BM_BackupStepRestore)->range(MIN_PLANS, MAX_PLANS, 10);
+
+int main(int argc, char **argv) {
+    return runBenchmarks(argc, argv);
+}
@@ -0,0 +1,38 @@
+#include "Workload.h"
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+
+void writeWorkload(const string &path, const WorkloadShape &shape) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write workload: " + path);
+    }
+    std::mt19937 random(shape.seed);
+    auto uniform = [&](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(random);
+    };
+    const char *policies[] = {"nve", "bal", "eco", "env"};
+    for (int i = 0; i < shape.settlements; ++i) {
+        out << "settlement Settlement" << i << " " << uniform(0, 2) << "\n";
+    }
+    for (int i = 0; i < shape.facilities; ++i) {
+        out << "facility Facility" << i << " " << uniform(0, 2) << " " << uniform(1, shape.maxCost) << " "
+            << uniform(0, 5) << " " << uniform(0, 5) << " " << uniform(0, 5) << "\n";
+    }
+    for (int i = 0; i < shape.plans; ++i) {
+        out << "plan Settlement" << uniform(0, shape.settlements - 1) << " " << policies[uniform(0, 3)] << "\n";
+    }
+}
+
+string temporaryWorkload(const WorkloadShape &shape) {
+    string path = "/tmp/workload_" + std::to_string(getpid()) + "_" + std::to_string(shape.plans) + "_" +
+                  std::to_string(shape.settlements) + "_" + std::to_string(shape.facilities) + ".txt";
+    writeWorkload(path, shape);
+    return path;
+}
+
+long workloadLines(const WorkloadShape &shape) {
+    return static_cast<long>(shape.settlements) + shape.facilities + shape.plans;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+using std::string;
+
+// Size and makeup of a synthetic workload: a configuration file in the config_file.txt grammar,
+// generated from a seed so the same shape always gives the same file
+struct WorkloadShape {
+    WorkloadShape() : settlements(100), facilities(50), plans(1000), seed(1), maxCost(5) {}
+    int settlements; //Of random type
+    int facilities; //Random category, cost 1 to maxCost and impacts 0 to 5
+    int plans; //Random settlement and selection policy
+    unsigned seed;
+    int maxCost;
+};
+
+void writeWorkload(const string &path, const WorkloadShape &shape);
+// Writes the workload to a file of its own in /tmp and returns the path
+string temporaryWorkload(const WorkloadShape &shape);
+long workloadLines(const WorkloadShape &shape);
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include "Simulation.h"
+#include "Arena.h"
 enum class SettlementType;
 enum class FacilityCategory;
 
@@ -16,9 +17,15 @@ class BaseAction{
         virtual void act(Simulation& simulation)=0;
         virtual const string toString() const=0;
         virtual BaseAction* clone() const = 0;
+        ActionRecord record(StringPool &strings) const; //For the actions log
+        static BaseAction* fromRecord(const ActionRecord &record, const StringPool &strings, Arena &arena); //Rebuilds the action in arena
+        // How the pipelined command loop may run the action
+        virtual bool isReadOnly() const; //Only reads the simulation, so a copy of it will do
+        virtual bool printsOutput() const; //False if it never prints while it runs
         virtual ~BaseAction() = default;
 
     protected:
+        virtual void recordArguments(ActionRecord &record, StringPool &strings) const = 0; //Type tag and constructor arguments
         void complete();
         void error(string errorMsg);
         const string &getErrorMsg() const;
@@ -33,8 +40,11 @@ class SimulateStep : public BaseAction {
     public:
         SimulateStep(const int numOfSteps);
         void act(Simulation &simulation) override;
+        bool printsOutput() const override;
         const string toString() const override;
         SimulateStep *clone() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const int numOfSteps;
 };
@@ -45,6 +55,8 @@ class AddPlan : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         AddPlan *clone() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const string settlementName;
         const string selectionPolicy;
@@ -57,6 +69,8 @@ class AddSettlement : public BaseAction {
         void act(Simulation &simulation) override;
         AddSettlement *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const string settlementName;
         const SettlementType settlementType;
@@ -70,6 +84,8 @@ class AddFacility : public BaseAction {
         void act(Simulation &simulation) override;
         AddFacility *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const string facilityName;
         const FacilityCategory facilityCategory;
@@ -84,31 +100,72 @@ class PrintPlanStatus: public BaseAction {
     public:
         PrintPlanStatus(int planId);
         void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
         PrintPlanStatus *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const int planId;
 };
 
 
+// planStatus for many plans at once; see Simulation::exportPlansStatus
+class ExportPlansStatus : public BaseAction {
+    public:
+        ExportPlansStatus(const Simulation::PlanQuery &query, PlanExportFormat format, const string &path);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        ExportPlansStatus *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+        const Simulation::PlanQuery query;
+        const PlanExportFormat format;
+        const string path; //Empty for standard output
+};
+
+
 class ChangePlanPolicy : public BaseAction {
     public:
         ChangePlanPolicy(const int planId, const string &newPolicy);
         void act(Simulation &simulation) override;
         ChangePlanPolicy *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
         const int planId;
         const string newPolicy;
 };
 
 
+// Prints the scores a plan would reach after numOfSteps steps under each of policyTypes
+class ComparePolicies : public BaseAction {
+    public:
+        ComparePolicies(const int planId, const int numOfSteps, const vector<string> &policyTypes);
+        void act(Simulation &simulation) override;
+        ComparePolicies *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+        const int planId;
+        const int numOfSteps;
+        const vector<string> policyTypes;
+};
+
+
 class PrintActionsLog : public BaseAction {
     public:
         PrintActionsLog();
         void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
         PrintActionsLog *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
 };
 
@@ -118,24 +175,81 @@ class Close : public BaseAction {
         void act(Simulation &simulation) override;
         Close *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
 };
 
 class BackupSimulation : public BaseAction {
     public:
         BackupSimulation();
+        BackupSimulation(const string &checkpointName); //Empty for the unnamed backup
         void act(Simulation &simulation) override;
         BackupSimulation *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
+        const string checkpointName;
 };
 
 
 class RestoreSimulation : public BaseAction {
     public:
         RestoreSimulation();
+        RestoreSimulation(const string &checkpointName); //Empty for the unnamed backup
         void act(Simulation &simulation) override;
         RestoreSimulation *clone() const override;
         const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+        const string checkpointName;
+};
+
+class PrintMemoryUsage : public BaseAction {
+    public:
+        PrintMemoryUsage();
+        void act(Simulation &simulation) override;
+        PrintMemoryUsage *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+};
+
+class SaveSimulation : public BaseAction {
+    public:
+        SaveSimulation(const string &path);
+        void act(Simulation &simulation) override;
+        SaveSimulation *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+        const string path;
+};
+
+class LoadSimulation : public BaseAction {
+    public:
+        LoadSimulation(const string &path);
+        void act(Simulation &simulation) override;
+        LoadSimulation *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
+    private:
+        const string path;
+};
+
+class PrintStats : public BaseAction {
+    public:
+        PrintStats();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintStats *clone() const override;
+        const string toString() const override;
+    protected:
+        void recordArguments(ActionRecord &record, StringPool &strings) const override;
     private:
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Arena.h"
+#include "CowPointer.h"
+#include "StringPool.h"
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+class BaseAction;
+class SnapshotReader;
+class SnapshotWriter;
+
+// A logged action as a fixed-size record: its type tag, its outcome and its constructor
+// arguments, with strings kept as IDs in the log's StringPool. See BaseAction::record.
+struct ActionRecord {
+    ActionRecord();
+    uint8_t tag;
+    uint8_t status; //ActionStatus
+    uint8_t option; //A SettlementType, FacilityCategory or PlanExportFormat argument
+    int32_t values[4];
+    uint32_t strings[2];
+    uint32_t errorMsg;
+};
+
+// Append-only list of the actions run by a simulation, as records in blocks of BLOCK_SIZE.
+// Full blocks never change and are shared between a log and its copies, and so is the last,
+// partly filled one until either side adds to it, so copying a log copies no records.
+// Actions are only rebuilt from their records when they are read. With a limit set, the log
+// keeps just the last limit actions, dropping whole blocks of older ones as it grows.
+class ActionsLog {
+    public:
+        ActionsLog();
+        void add(const BaseAction &action); //Stores a record of action
+        size_t size() const; //Actions kept
+        // Rebuilds action index, oldest kept first, in arena
+        BaseAction *get(size_t index, Arena &arena) const;
+        void setLimit(size_t limit); //0 keeps every action
+        size_t getLimit() const;
+        void save(SnapshotWriter &writer) const; //The actions kept
+        void load(SnapshotReader &reader); //Adds the actions written by save
+
+        // Records held, counting the older ones still in a kept block, and the shared string pool
+        size_t getRecordCount() const;
+        size_t getBytesUsed() const;
+        size_t getBytesReserved() const;
+        size_t getStringCount() const;
+        size_t getStringBytes() const;
+
+        static const size_t BLOCK_SIZE = 256;
+
+    private:
+        typedef vector<ActionRecord> Block;
+        const ActionRecord &getRecord(size_t index) const;
+        void append(const ActionRecord &record);
+        void dropOldBlocks();
+
+        CowPointer<vector<shared_ptr<const Block>>> sealed; //Full blocks, oldest first
+        CowPointer<Block> tail; //Block being filled
+        shared_ptr<StringPool> strings; //Shared by every copy of the log
+        size_t limit;
+};
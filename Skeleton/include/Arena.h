@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+using std::size_t;
+using std::vector;
+
+// Bump allocator for objects that are released together. Objects are carved out of
+// large blocks and destroyed in reverse order of creation by release(), which then
+// frees every block at once instead of one delete per object.
+class Arena {
+    public:
+        Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+        Arena(const Arena &other) = delete;
+        Arena &operator=(const Arena &other) = delete;
+        ~Arena();
+
+        template <typename T, typename... Args>
+        T *create(Args &&...args) {
+            void *memory = allocate(sizeof(T), alignof(T));
+            T *object = new (memory) T(std::forward<Args>(args)...);
+            destructors.push_back(Destructor{&destroy<T>, object});
+            return object;
+        }
+        void release();
+        // Like release(), but keeps the first block so the arena can be refilled without allocating
+        void reset();
+
+        size_t getObjectCount() const;
+        size_t getBytesUsed() const; //Bytes handed out to objects, padding included
+        size_t getBytesReserved() const; //Bytes held in blocks
+
+        static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    private:
+        struct Destructor {
+            void (*destroy)(void *object);
+            void *object;
+        };
+        template <typename T>
+        static void destroy(void *object) {
+            static_cast<T *>(object)->~T();
+        }
+        void *allocate(size_t size, size_t alignment);
+        void destroyObjects();
+
+        const size_t blockSize;
+        vector<char *> blocks;
+        vector<size_t> blockSizes;
+        char *cursor;
+        char *blockEnd;
+        size_t bytesUsed;
+        size_t bytesReserved;
+        vector<Destructor> destructors;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+using std::size_t;
+using std::string;
+
+// A piece of the mapped config file. Doesn't own its characters.
+struct TokenView {
+    const char *data;
+    size_t length;
+
+    bool equals(const char *text) const;
+    string str() const;
+};
+
+// Read-only memory mapping of a config file, read line by line without copying.
+class ConfigFile {
+    public:
+        ConfigFile(const string &path);
+        ConfigFile(const ConfigFile &other) = delete;
+        ConfigFile &operator=(const ConfigFile &other) = delete;
+        ~ConfigFile();
+        const char *getData() const;
+        size_t getSize() const;
+
+        // Moves to the next line (without its '\n'); returns false at the end of the file
+        bool nextLine(TokenView &line);
+
+        static const size_t MAX_TOKENS = 8;
+
+    private:
+        const char *data;
+        size_t size;
+        size_t position;
+};
+
+// Start of the first line that begins at or after position in data[0, size), or size if there is none.
+// Splitting a buffer at aligned positions gives chunks that hold whole lines only.
+size_t alignToLine(const char *data, size_t size, size_t position);
+// Reads the line at position in data[0, end) (without its '\n') and moves position past it
+bool nextLine(const char *data, size_t end, size_t &position, TokenView &line);
+// Splits line on whitespace into at most maxTokens tokens; returns how many were found
+size_t tokenize(const TokenView &line, TokenView *tokens, size_t maxTokens);
+// Parses an optionally signed decimal int; false if the token is anything else or overflows
+bool parseInt(const TokenView &token, int &value);
@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <utility>
+using std::shared_ptr;
+
+// Shared pointer with copy-on-write. Copies share the object, which can only be read through
+// them; write() first gives the caller a copy of its own if anyone else still shares it.
+// A copy may be read on one thread while another thread writes through a different copy.
+template <typename T>
+class CowPointer {
+    public:
+        CowPointer() : object(std::make_shared<T>()) {}
+        explicit CowPointer(shared_ptr<T> object) : object(std::move(object)) {}
+
+        const T &operator*() const {
+            return *object;
+        }
+        const T *operator->() const {
+            return object.get();
+        }
+        T &write() {
+            if (object.use_count() != 1) {
+                object = std::make_shared<T>(*object);
+            }
+            return *object;
+        }
+
+    private:
+        shared_ptr<T> object;
+};
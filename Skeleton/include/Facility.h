@@ -45,6 +45,7 @@ class Facility: public FacilityType {
         const string &getSettlementName() const;
         const int getTimeLeft() const;
         FacilityStatus step();
+        FacilityStatus advance(int steps);
         void setStatus(FacilityStatus status);
         const FacilityStatus& getStatus() const;
         const string toString() const;
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Facility.h"
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+typedef int FacilityId;
+
+// Facility types grouped by their score offsets (economy - life quality, environment - life quality).
+// All types in a group rank the same under BalancedSelection, so only the first of them, by id,
+// can ever be selected. Stored as packed columns, one entry per group in order of first appearance.
+struct BalanceGroups {
+    BalanceGroups() : economyOffsets(), environmentOffsets(), firstIds() {}
+    vector<int> economyOffsets;
+    vector<int> environmentOffsets;
+    vector<FacilityId> firstIds;
+};
+
+// The facility types known to a simulation. Each type is stored once and referred to
+// everywhere else by its FacilityId, which is its position in registration order.
+class FacilityCatalog {
+    public:
+        FacilityCatalog();
+        FacilityCatalog(const FacilityCatalog &other) = default;
+        FacilityCatalog &operator=(const FacilityCatalog &other);
+        void swap(FacilityCatalog &other);
+        FacilityId add(const FacilityType &facilityType);
+        FacilityId find(const string &name) const;
+        bool contains(const string &name) const;
+        const FacilityType &get(FacilityId id) const;
+        const vector<FacilityType> &getTypes() const;
+        const vector<FacilityId> &getCategory(FacilityCategory category) const;
+        const BalanceGroups &getBalanceGroups() const;
+        size_t size() const;
+        bool empty() const;
+
+        static const FacilityId NO_FACILITY = -1;
+
+    private:
+        vector<FacilityType> types;
+        unordered_map<string, FacilityId> ids; //Name -> id
+        vector<FacilityId> categories[3]; //Ids of each FacilityCategory, in registration order
+        BalanceGroups balanceGroups;
+        unordered_map<unsigned long long, size_t> balanceGroupIndex; //Packed offsets -> group index
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "FacilityCatalog.h"
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+// Append-only list of the facility types a plan has started, in start order. Types are
+// stored in chunks of CHUNK_SIZE; full chunks never change and are shared between a history
+// and its copies, so copying a history only copies its last, partly filled chunk.
+class FacilityHistory {
+    public:
+        FacilityHistory();
+        void push_back(FacilityId facilityType);
+        void append(const FacilityId *facilityTypes, size_t count); //As count push_backs
+        size_t size() const;
+        FacilityId operator[](size_t slot) const;
+
+        static const size_t CHUNK_SIZE = 64;
+
+    private:
+        vector<shared_ptr<const vector<FacilityId>>> sealed;
+        vector<FacilityId> tail;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+using std::size_t;
+
+class OutputWriter;
+
+// Hot-path instrumentation. A probe counts the calls to a stretch of code and times them;
+// every thread keeps counters of its own, so threads never write to shared ones, and they are
+// only added up when printed (the stats command). Allocations through operator new are counted
+// the same way. Build with -DNO_INSTRUMENTATION to compile all of it out.
+//
+//     void Plan::step(...) {
+//         INSTRUMENT_SCOPE("Plan::step"); //Times the rest of the scope
+//
+// Reading the clock costs more than some of the code probed, so a probe on a per-plan path
+// (INSTRUMENT_HOT_SCOPE) counts every call but times only one call in HOT_SAMPLE_INTERVAL; its
+// total time is scaled up from the calls timed.
+class Probe {
+    public:
+        explicit Probe(const char *name, unsigned sampleInterval = 1); //Probes live as long as the program
+        Probe(const Probe &other) = delete;
+        Probe &operator=(const Probe &other) = delete;
+        bool begin() const; //Counts a call; true if it is one to time
+        void end(uint64_t nanoseconds) const; //Time of a call begin() picked
+
+        static const size_t MAX_PROBES = 64;
+        static const unsigned HOT_SAMPLE_INTERVAL = 64;
+
+    private:
+        size_t index;
+        unsigned sampleInterval;
+};
+
+class ScopedTimer {
+    public:
+        explicit ScopedTimer(const Probe &probe) : probe(probe), start(probe.begin() ? now() : NOT_TIMED) {}
+        ScopedTimer(const ScopedTimer &other) = delete;
+        ScopedTimer &operator=(const ScopedTimer &other) = delete;
+        ~ScopedTimer() {
+            if (start != NOT_TIMED) {
+                probe.end(now() - start);
+            }
+        }
+
+    private:
+        static uint64_t now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        static const uint64_t NOT_TIMED = UINT64_MAX;
+        const Probe &probe;
+        const uint64_t start;
+};
+
+// Every probe that has run, with its call count and total, mean and 99th percentile time,
+// then the allocations made so far
+void printInstrumentation(OutputWriter &out);
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#ifdef NO_INSTRUMENTATION
+#define INSTRUMENT_SAMPLED_SCOPE(name, sampleInterval)
+#else
+#define INSTRUMENT_SAMPLED_SCOPE(name, sampleInterval) \
+    static const Probe INSTRUMENT_CONCAT(instrumentProbe, __LINE__)(name, sampleInterval); \
+    ScopedTimer INSTRUMENT_CONCAT(instrumentTimer, __LINE__)(INSTRUMENT_CONCAT(instrumentProbe, __LINE__))
+#endif
+#define INSTRUMENT_SCOPE(name) INSTRUMENT_SAMPLED_SCOPE(name, 1)
+#define INSTRUMENT_HOT_SCOPE(name) INSTRUMENT_SAMPLED_SCOPE(name, Probe::HOT_SAMPLE_INTERVAL)
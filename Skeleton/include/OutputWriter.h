@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+using std::size_t;
+using std::string;
+using std::vector;
+
+enum class OutputFormat {
+    TEXT,
+    JSON, //One JSON object per line, with a "type" field naming the record
+};
+
+// Buffered writer for a file descriptor. Output is formatted into a buffer that is reused
+// between flushes and handed to write() once BLOCK_SIZE bytes have built up or flush() is
+// called, rather than once per line as std::endl does.
+class OutputWriter {
+    public:
+        explicit OutputWriter(int fd);
+        OutputWriter(const OutputWriter &other) = delete;
+        OutputWriter &operator=(const OutputWriter &other) = delete;
+        ~OutputWriter(); //Flushes
+        OutputWriter &operator<<(const string &text);
+        OutputWriter &operator<<(const char *text);
+        OutputWriter &operator<<(char character);
+        OutputWriter &operator<<(int value);
+        OutputWriter &operator<<(long long value);
+        OutputWriter &operator<<(size_t value);
+        void write(const char *data, size_t length);
+        void writeJsonString(const string &text); //Quoted, with JSON escapes
+        void flush();
+        OutputFormat getFormat() const;
+        void setFormat(OutputFormat format);
+        size_t getWriteCount() const; //write() calls made so far
+        bool hasFailed() const; //A write() failed, and the output is incomplete
+
+        static const size_t BLOCK_SIZE = 64 * 1024;
+
+    private:
+        void writeUnsigned(unsigned long long value);
+
+        int fd;
+        vector<char> buffer;
+        OutputFormat format;
+        size_t writeCount;
+        bool failed;
+};
+
+// Writer for standard output; everything the simulation prints goes through it
+OutputWriter &standardOutput();
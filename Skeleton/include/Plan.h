@@ -1,10 +1,17 @@
 #pragma once
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "FacilityHistory.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
 using std::vector;
 
+class SnapshotReader;
+class SnapshotWriter;
+
+typedef long long Tick; //Steps taken by the simulation
+
 enum class PlanStatus {
     AVAILABLE,
     BUSY,
@@ -12,25 +19,55 @@ enum class PlanStatus {
 
 class Plan {
     public:
-        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
+        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy);
+        Plan(const Plan &other);
+        Plan(Plan &&other) noexcept;
+        Plan(SnapshotReader &reader, const Settlement &settlement, const FacilityCatalog &facilityOptions, Tick now);
+        Plan &operator=(const Plan &other) = delete;
+        ~Plan();
+        const Settlement &getSettlement() const;
+        const SelectionPolicy &getSelectionPolicy() const;
         const int getLifeQualityScore() const;
         const int getEconomyScore() const;
         const int getEnvironmentScore() const;
+        PlanStatus getStatus() const;
         void setSelectionPolicy(SelectionPolicy *selectionPolicy);
-        void step();
-        void printStatus();
-        const vector<Facility*> &getFacilities() const;
-        void addFacility(Facility* facility);
+        // The facility options and the current tick are passed in rather than kept, so a plan
+        // can be shared by simulations whose options differ (see Simulation::backup), and a plan
+        // that is only waiting for its facilities doesn't change from one step to the next
+        void step(const FacilityCatalog &facilityOptions, Tick now); //now: the tick being stepped to
+        int stepsUntilEvent(const FacilityCatalog &facilityOptions, Tick now) const;
+        void printStatus() const;
+        vector<Facility> getFacilities(const FacilityCatalog &facilityOptions, Tick now) const;
+        vector<Facility> getUnderConstruction(const FacilityCatalog &facilityOptions, Tick now) const;
+        size_t getFacilityCount() const; //Operational facilities, without building them as getFacilities does
+        size_t getUnderConstructionCount() const;
+        void addFacility(const Facility &facility, const FacilityCatalog &facilityOptions, Tick now);
         const string toString() const;
         const int getPlanID() const;
+        void save(SnapshotWriter &writer) const; //Everything but the settlement, which the simulation records
         
+        static const int NO_EVENT;
+        static const int MAX_CONSTRUCTION_LIMIT = 3; //Construction slots of a METROPOLIS
+
     private:
+        // A facility being built: its slot in facilities and the tick it is completed in
+        struct Construction {
+            size_t slot;
+            Tick doneTick;
+        };
+        int constructionLimit() const;
+        void completeConstructions(const FacilityCatalog &facilityOptions, Tick now);
+        Facility buildFacility(size_t slot, const FacilityCatalog &facilityOptions, Tick now) const;
         int plan_id;
         const Settlement *settlement;
         SelectionPolicy *selectionPolicy; //What happens if we change this to a reference?
         PlanStatus status;
-        vector<Facility*> facilities;
-        vector<Facility*> underConstruction;
-        const vector<FacilityType> &facilityOptions;
+        // Types of the facilities started so far; name, scores and settlement are looked up on
+        // demand. A started facility never changes again once it is built, so copies of a plan
+        // share all but the newest of them, and only the few still being built are kept apart.
+        FacilityHistory facilities;
+        vector<Construction> underConstruction; //In the order they were started
         int life_quality_score, economy_score, environment_score;
+        size_t failedSelectionOptions; //facilityOptions.size() when the policy last failed to select, npos if it didn't
 };
\ No newline at end of file
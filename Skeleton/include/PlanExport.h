@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include "OutputWriter.h"
+#include "Plan.h"
+using std::vector;
+
+// Bulk plan status, one row per plan: plan ID, settlement, status, the three scores and the
+// number of operational and under construction facilities.
+enum class PlanExportFormat {
+    CSV, //Header line, then one line per plan
+    COLUMNS, //Binary, one column after the other; see writePlanColumns
+};
+
+void writePlanCsv(OutputWriter &out, const vector<const Plan *> &plans);
+void writePlanJson(OutputWriter &out, const vector<const Plan *> &plans); //planStatus records, as in output json mode
+// Layout, values in host byte order:
+//   header     "PLANCOLS", uint32 version, uint32 byte order mark 0x01020304, uint64 row count
+//   int32      plan ID, settlement index, life quality, economy and environment score,
+//              operational and under construction facility count: one column of each
+//   uint8      status column, 0 AVAILABLE and 1 BUSY
+//   names      uint64 count, then uint32 length and bytes of each settlement name, by index
+// The 4-byte columns come first so each starts aligned.
+void writePlanColumns(OutputWriter &out, const vector<const Plan *> &plans);
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CowPointer.h"
+#include "Plan.h"
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+// The plans of a simulation in the order they were added, kept in chunks of CHUNK_SIZE.
+// Copies of a table share its chunks, and chunks share their plans, until a copy writes to
+// them, so a copy only ever owns the chunks and plans that changed after it was made.
+class PlanTable {
+    public:
+        PlanTable();
+        size_t size() const;
+        const Plan &get(size_t index) const;
+        // Gives this table its own copy of the plan, and of its chunk, if they are shared.
+        // Plans in different chunks may be written from different threads.
+        Plan &write(size_t index);
+        size_t indexOf(int planId) const; //npos if there is no such plan
+        void add(const shared_ptr<Plan> &plan);
+        void reserve(size_t count);
+
+        static const size_t CHUNK_SIZE = 64;
+
+    private:
+        typedef vector<CowPointer<Plan>> Chunk;
+        vector<CowPointer<Chunk>> chunks;
+        CowPointer<vector<int>> slots; //Plan ID -> index, -1 if there is no such plan; only changed by add
+        size_t planCount;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+using std::size_t;
+
+enum class ScoringKernel {
+    SCALAR,
+    SSE41,
+    AVX2,
+    AVX512,
+};
+
+// Balance scoring over packed int32 score columns, used by the selection policies.
+// The widest kernel the CPU supports is picked the first time one is needed.
+//
+// Returns the index of the first candidate in [0, count) whose balance difference
+// (max - min of lifeQuality, economy + economyScores[i], environment + environmentScores[i])
+// is smallest, and stores that difference in bestDifference. Returns count if count is 0.
+size_t findMostBalanced(const int *economyScores, const int *environmentScores, size_t count, int lifeQuality,
+                        int economy, int environment, int &bestDifference);
+
+ScoringKernel getScoringKernel();
+// Forces a kernel; returns false (and changes nothing) if the CPU doesn't support it
+bool setScoringKernel(ScoringKernel kernel);
+const char *scoringKernelName(ScoringKernel kernel);
@@ -1,22 +1,35 @@
 #pragma once
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
 using std::vector;
 
+class SnapshotReader;
+class SnapshotWriter;
+
 class SelectionPolicy {
     public:
-        virtual const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) = 0;
+        virtual FacilityId selectFacility(const FacilityCatalog& facilitiesOptions) = 0;
+        // Makes up to count selections in a row, exactly as count calls to selectFacility would,
+        // and writes them to out. Returns how many were made; fewer than count means nothing more
+        // can be selected from these options. Never throws.
+        virtual int selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) = 0;
         virtual const string toString() const = 0;
         virtual SelectionPolicy* clone() const = 0;
+        virtual void save(SnapshotWriter& writer) const = 0; //Type tag followed by the policy's state
+        static SelectionPolicy* load(SnapshotReader& reader); //Reads a policy written by save
         virtual ~SelectionPolicy() = default;
 };
 
 class NaiveSelection: public SelectionPolicy {
     public:
         NaiveSelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        explicit NaiveSelection(int lastSelectedIndex); //Continues a round-robin after lastSelectedIndex
+        FacilityId selectFacility(const FacilityCatalog& facilitiesOptions) override;
+        int selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) override;
         const string toString() const override;
         NaiveSelection *clone() const override;
+        void save(SnapshotWriter& writer) const override;
         ~NaiveSelection() override = default;
     private:
         int lastSelectedIndex;
@@ -25,34 +38,53 @@ class NaiveSelection: public SelectionPolicy {
 class BalancedSelection: public SelectionPolicy {
     public:
         BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore);
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        BalancedSelection(const BalancedSelection &other) = default;
+        BalancedSelection &operator=(const BalancedSelection &other) = default;
+        FacilityId selectFacility(const FacilityCatalog& facilitiesOptions) override;
+        int selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) override;
         const string toString() const override;
         BalancedSelection *clone() const override;
+        void save(SnapshotWriter& writer) const override;
         ~BalancedSelection() override = default;
     private:
+        void updateBestFacility(const FacilityCatalog& facilitiesOptions);
         int LifeQualityScore;
         int EconomyScore;
         int EnvironmentScore;
+        // Best choice over the first scannedGroups balance groups of indexedCatalog
+        const FacilityCatalog *indexedCatalog;
+        size_t scannedGroups;
+        FacilityId bestFacility;
+        int bestDifference;
 };
 
+// Round-robin over the ids in `candidates`, continuing from lastSelectedIndex. Shared by the
+// policies that cycle through a list of facilities.
+int selectRoundRobin(const vector<FacilityId>& candidates, int &lastSelectedIndex, int count, FacilityId *out);
+
 class EconomySelection: public SelectionPolicy {
     public:
         EconomySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        explicit EconomySelection(int lastSelectedIndex); //Continues a round-robin after lastSelectedIndex
+        FacilityId selectFacility(const FacilityCatalog& facilitiesOptions) override;
+        int selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) override;
         const string toString() const override;
         EconomySelection *clone() const override;
+        void save(SnapshotWriter& writer) const override;
         ~EconomySelection() override = default;
     private:
         int lastSelectedIndex;
-
 };
 
 class SustainabilitySelection: public SelectionPolicy {
     public:
         SustainabilitySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        explicit SustainabilitySelection(int lastSelectedIndex); //Continues a round-robin after lastSelectedIndex
+        FacilityId selectFacility(const FacilityCatalog& facilitiesOptions) override;
+        int selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) override;
         const string toString() const override;
         SustainabilitySelection *clone() const override;
+        void save(SnapshotWriter& writer) const override;
         ~SustainabilitySelection() override = default;
     private:
         int lastSelectedIndex;
@@ -1,37 +1,131 @@
 #pragma once
+#include <climits>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "ActionsLog.h"
+#include "Arena.h"
+#include "CowPointer.h"
 #include "Facility.h"
+#include "FacilityCatalog.h"
 #include "Plan.h"
+#include "PlanExport.h"
+#include "PlanTable.h"
 #include "Settlement.h"
+#include "ThreadPool.h"
+#include "TimingWheel.h"
+using std::shared_ptr;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 class BaseAction;
 class SelectionPolicy;
+class ConfigFile;
+struct StagedConfigLine;
 
 class Simulation {
     public:
-        Simulation(const string &configFilePath);
+        // Scores a plan ends up with under one selection policy; see comparePolicies
+        struct PolicyOutcome {
+            PolicyOutcome() : policyType(), isCurrent(false), lifeQualityScore(0), economyScore(0), environmentScore(0) {}
+            string policyType;
+            bool isCurrent; //The policy the plan uses now
+            int lifeQualityScore, economyScore, environmentScore;
+        };
+
+        // Which plans exportPlansStatus covers: all of them unless narrowed down
+        struct PlanQuery {
+            PlanQuery() : firstPlanId(0), lastPlanId(INT_MAX), settlementType(-1), policyType() {}
+            int firstPlanId, lastPlanId; //Inclusive
+            int settlementType; //-1 for any
+            string policyType; //Empty for any
+        };
+
+        Simulation(const string &configFilePath, int threadCount = ThreadPool::defaultThreadCount());
+        Simulation(const Simulation &other);
+        Simulation &operator=(const Simulation &other);
+        ~Simulation();
         void start();
         void addPlan(const Settlement *settlement, SelectionPolicy *selectionPolicy);
-        void addAction(BaseAction *action);
+        void addPlan(const string &settlementName, const string &selectionPolicy);
+        void addAction(const BaseAction &action); //Stores a copy of action
         bool addSettlement(Settlement *settlement);
-        bool addFacility(FacilityType facility);
+        void addSettlement(const string &settlementName, SettlementType settlementType);
+        bool addFacility(const FacilityType &facility);
         bool isSettlementExists(const string &settlementName);
-        Settlement *getSettlement(const string &settlementName);
-        Plan &getPlan(const int planID);
+        const Settlement *getSettlement(const string &settlementName) const;
+        const Plan &getPlan(const int planID) const;
+        void getPlanStatus(const int planID);
+        // Writes the status of the plans matching query in one pass, to path or, if it is empty,
+        // to standard output. Throws runtime_error if the file can't be written.
+        void exportPlansStatus(const PlanQuery &query, PlanExportFormat format, const string &path);
+        void changePlanPolicy(const int planID, const string &newPolicy);
+        vector<PolicyOutcome> comparePolicies(const int planID, int numOfSteps, const vector<string> &policyTypes);
+        void printActionsLog() const;
+        void printMemoryUsage() const;
+        void backup() const;
+        void restore();
+        void backup(const string &checkpointName);
+        void restore(const string &checkpointName);
+        void saveSnapshot(const string &path) const;
+        void loadSnapshot(const string &path);
         void step();
+        void step(int numOfSteps);
+        void setThreadCount(int threadCount);
+        void setActionsLogLimit(size_t limit); //Keep only the last limit actions; 0 keeps them all
+        void setPipelined(bool pipelined);
         void close();
         void open();
 
     private:
+        // Settlements in the order they were added, and by name. Settlements never change
+        // once added, so copies of the table share them.
+        struct SettlementTable {
+            SettlementTable() : ordered(), byName() {}
+            vector<shared_ptr<const Settlement>> ordered;
+            unordered_map<string, const Settlement *> byName;
+        };
+
+        // The plans of one shard of the schedule, by when they next start or finish a facility.
+        // A plan is in one of the two, or in neither if nothing but a command can wake it up.
+        struct ScheduleShard {
+            explicit ScheduleShard(Tick time) : active(), parked(time) {}
+            vector<size_t> active; //Due at every tick: AVAILABLE, with a free slot and a facility to select
+            TimingWheel parked; //Due at a later tick: BUSY until a completion, or waiting for one
+        };
+
         bool isRunning;
         int planCounter; //For assigning unique plan IDs
-        vector<BaseAction*> actionsLog;
-        vector<Plan> plans;
-        vector<Settlement*> settlements;
-        vector<FacilityType> facilitiesOptions;
+        Tick currentTick; //Steps taken so far
+        ActionsLog actionsLog;
+        // Copies of a simulation (backups) share these until either side changes them
+        CowPointer<PlanTable> plans;
+        CowPointer<SettlementTable> settlements;
+        CowPointer<FacilityCatalog> facilitiesOptions;
+        ThreadPool stepPool; //Runs Plan::step on chunks of plans in parallel
+        // When each plan next starts or finishes a facility, for every shard of
+        // SCHEDULE_SHARD_SIZE plans, so that shards are stepped on threads of their own. It
+        // follows from the plans, so copies don't take it. Empty until a step works it out
+        // again, after anything but a step or a new plan or policy has changed the plans.
+        vector<ScheduleShard> schedule;
+        Arena commandArena; //Holds the action of the command being run
+        // Named backups. Not part of the state they record, so copying or restoring a
+        // simulation leaves them alone.
+        unordered_map<string, shared_ptr<const Simulation>> checkpoints;
+        bool pipelined; //How start() runs commands; a setting, not state, so copies don't take it
+        BaseAction *parseCommand(const string &line, Arena &arena);
+        void runCommands();
+        void runCommandsPipelined();
+        Plan &getMutablePlan(const int planID);
+        void loadConfigSerial(ConfigFile &configFile);
+        bool loadConfigParallel(const ConfigFile &configFile);
+        void applyConfigLine(const StagedConfigLine &staged);
+        void buildSchedule();
+        void reschedulePlan(size_t planIndex);
+        void fastForward(PlanTable &planTable, ScheduleShard &shard, size_t firstPlan, Tick endTick);
+        static void schedulePlan(const Plan &plan, const FacilityCatalog &catalog, ScheduleShard &shard, size_t item, Tick now);
         FacilityCategory parseFacilityCategory(const string &category);
-        SelectionPolicy *createPolicy(const string &policyType);
+        SelectionPolicy *createPolicy(const string &policyType, int lifeQualityScore = 0, int economyScore = 0, int environmentScore = 0);
 };
\ No newline at end of file
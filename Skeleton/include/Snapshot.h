@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+using std::size_t;
+using std::string;
+using std::vector;
+
+// Binary snapshot of a simulation: a header (magic, format version, byte order mark) followed
+// by the sections written by Simulation::saveSnapshot. Values are stored in host byte order;
+// a snapshot from a machine of the other endianness or another version is rejected, not misread.
+
+// Collects a snapshot in memory so it can be written to disk with a single write
+class SnapshotWriter {
+    public:
+        SnapshotWriter();
+        void writeByte(uint8_t value);
+        void writeInt(int32_t value);
+        void writeSize(uint64_t value);
+        void writeString(const string &value);
+        // Raw copy of count trivially copyable values
+        template <typename T>
+        void writeArray(const T *values, size_t count) {
+            writeBytes(values, count * sizeof(T));
+        }
+        // Writes the snapshot to path through a temporary file, so an existing snapshot
+        // is only replaced by a complete one. Throws runtime_error on failure.
+        void save(const string &path) const;
+
+    private:
+        void writeBytes(const void *data, size_t length);
+        vector<char> buffer;
+};
+
+// Reads a snapshot from a read-only memory mapping, starting after its header. Every read
+// is bounds-checked and throws runtime_error on a truncated or malformed snapshot.
+class SnapshotReader {
+    public:
+        SnapshotReader(const string &path);
+        SnapshotReader(const SnapshotReader &other) = delete;
+        SnapshotReader &operator=(const SnapshotReader &other) = delete;
+        ~SnapshotReader();
+        uint8_t readByte();
+        int32_t readInt();
+        uint64_t readSize();
+        string readString();
+        // Reads a count written by writeSize and checks it against the bytes left, given
+        // that each counted item takes at least minItemSize bytes
+        size_t readCount(size_t minItemSize);
+        template <typename T>
+        void readArray(T *values, size_t count) {
+            const char *bytes = take(count * sizeof(T));
+            if (count > 0) {
+                std::memcpy(values, bytes, count * sizeof(T));
+            }
+        }
+        bool atEnd() const;
+
+    private:
+        const char *take(size_t length);
+        const char *data;
+        size_t size;
+        size_t position;
+};
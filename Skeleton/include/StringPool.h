@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+using std::deque;
+using std::size_t;
+using std::string;
+using std::unordered_map;
+
+// Interned strings: each distinct string is stored once and named by a small ID. Strings are
+// only ever added, so an ID and the string it names stay valid as long as the pool lives.
+// Safe to use from several threads.
+class StringPool {
+    public:
+        StringPool();
+        StringPool(const StringPool &other) = delete;
+        StringPool &operator=(const StringPool &other) = delete;
+        uint32_t intern(const string &text);
+        const string &get(uint32_t id) const; //Throws out_of_range for an unknown ID
+        size_t size() const;
+        size_t getBytesUsed() const; //Characters of the strings
+
+        static const uint32_t EMPTY = 0; //ID of ""
+
+    private:
+        struct Hash {
+            size_t operator()(const string *text) const {
+                return std::hash<string>()(*text);
+            }
+        };
+        struct Equal {
+            bool operator()(const string *left, const string *right) const {
+                return *left == *right;
+            }
+        };
+        mutable std::mutex mutex;
+        deque<string> strings; //By ID; a deque so growing it doesn't move the strings
+        unordered_map<const string *, uint32_t, Hash, Equal> ids; //Keys point into strings
+        size_t bytesUsed;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::size_t;
+using std::vector;
+
+// Persistent pool of worker threads. The calling thread takes part in every job,
+// so a pool of N threads keeps N-1 workers parked between jobs.
+class ThreadPool {
+    public:
+        ThreadPool(int threadCount);
+        ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+        ~ThreadPool();
+        int getThreadCount() const;
+        void setThreadCount(int threadCount);
+        static int defaultThreadCount();
+
+        // Splits [0, count) into chunks and runs task(begin, end) on each of them. Chunks start
+        // at multiples of grain, so a group of grain items is never split between two tasks.
+        // Returns once every chunk is done; the first exception thrown by a chunk is rethrown here.
+        void parallelFor(size_t count, const std::function<void(size_t, size_t)> &task, size_t grain = 1);
+        // Like parallelFor, for a few items that each make a job of their own: every item is
+        // run as a separate task(index, index + 1), however few of them there are.
+        void parallelEach(size_t count, const std::function<void(size_t, size_t)> &task);
+
+    private:
+        void runJob(size_t count, size_t size, const std::function<void(size_t, size_t)> &task);
+        void startWorkers();
+        void stopWorkers();
+        void workerLoop(unsigned long seenGeneration);
+        void runChunks();
+
+        int threadCount;
+        vector<std::thread> workers;
+        std::mutex stateMutex;
+        std::condition_variable wakeWorkers;
+        std::condition_variable jobDone;
+        const std::function<void(size_t, size_t)> *job;
+        size_t jobSize;
+        size_t chunkSize;
+        std::atomic<size_t> nextChunk;
+        size_t pendingWorkers;
+        unsigned long generation;
+        bool stopping;
+        std::exception_ptr failure;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Plan.h"
+using std::size_t;
+using std::vector;
+
+// Hierarchical timing wheel: items (numbered from 0) are each due at a tick, and are handed
+// back a tick at a time in order of their due ticks. There are LEVELS wheels of SLOTS slots;
+// a slot of level L spans SLOTS^L ticks. An item waits at the level of the highest base-SLOTS
+// digit in which its due tick differs from the wheel's time, and moves down once time reaches
+// its slot. Each level keeps a bitmap of its nonempty slots, so finding the next due tick skips
+// empty slots without visiting them, and the work done is in proportion to the items due, not
+// the items waiting. Items due beyond the top level wait in an overflow list.
+class TimingWheel {
+    public:
+        explicit TimingWheel(Tick time = 0); //Items can be due from tick time on
+        // Schedules item at due, which is no earlier than getTime(). An item is only ever
+        // scheduled once: this replaces its earlier due tick, if it has one.
+        void schedule(size_t item, Tick due);
+        void cancel(size_t item);
+        // Moves time on to the first tick up to limit that items are due at, and hands them
+        // over in due (replacing what it held). Returns false, with time moved on to limit + 1,
+        // if nothing is due until after limit.
+        bool popDue(Tick limit, Tick &tick, vector<size_t> &due);
+        Tick getTime() const;
+
+        static const size_t SLOT_BITS = 6;
+        static const size_t SLOTS = size_t(1) << SLOT_BITS;
+        static const size_t LEVELS = 4;
+
+    private:
+        // A rescheduled item keeps its old entry until the wheel gets to it, and it is dropped
+        // then: only the entry with the item's latest version counts
+        struct Entry {
+            uint32_t item;
+            uint32_t version;
+            Tick due;
+        };
+        bool isCurrent(const Entry &entry) const;
+        void place(const Entry &entry);
+        void moveTo(Tick newTime);
+        Tick nextSlotStart();
+
+        Tick time; //No item is due before it
+        vector<vector<Entry>> slots; //LEVELS * SLOTS, level by level
+        uint64_t occupied[LEVELS]; //Bit s of level L: slot s of level L holds entries
+        vector<Entry> overflow;
+        vector<uint32_t> versions; //Per item
+};
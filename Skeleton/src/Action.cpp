@@ -1,11 +1,10 @@
 #include "Action.h"
+#include "Instrumentation.h"
+#include "OutputWriter.h"
 #include "Simulation.h"
-#include <iostream>
 #include <stdexcept>
 #include <sstream>
 
-using std::cout;
-using std::endl;
 using std::string;
 using std::ostringstream;
 using std::runtime_error;
@@ -24,23 +23,135 @@ void BaseAction::complete() {
 void BaseAction::error(string errorMsg) {
     this->errorMsg = std::move(errorMsg);
     status = ActionStatus::ERROR;
-    cout << "Error: " << this->errorMsg << endl;
+    OutputWriter &out = standardOutput();
+    if (out.getFormat() == OutputFormat::JSON) {
+        out << "{\"type\":\"error\",\"message\":";
+        out.writeJsonString(this->errorMsg);
+        out << "}\n";
+    } else {
+        out << "Error: " << this->errorMsg << '\n';
+    }
 }
 
 const string &BaseAction::getErrorMsg() const {
     return errorMsg;
 }
 
+// Tags of the actions in their log records
+enum ActionTag {
+    STEP_ACTION, PLAN_ACTION, SETTLEMENT_ACTION, FACILITY_ACTION, PLAN_STATUS_ACTION, CHANGE_POLICY_ACTION,
+    ACTIONS_LOG_ACTION, CLOSE_ACTION, BACKUP_ACTION, RESTORE_ACTION, MEMORY_ACTION, SAVE_ACTION, LOAD_ACTION,
+    COMPARE_POLICIES_ACTION, EXPORT_PLANS_ACTION, STATS_ACTION
+};
+
+bool BaseAction::isReadOnly() const {
+    return false;
+}
+
+bool BaseAction::printsOutput() const {
+    return true;
+}
+
+ActionRecord BaseAction::record(StringPool &strings) const {
+    ActionRecord record;
+    recordArguments(record, strings);
+    record.status = static_cast<uint8_t>(status);
+    record.errorMsg = strings.intern(errorMsg);
+    return record;
+}
+
+// Splits the space-separated list in a record string
+static vector<string> splitWords(const string &text) {
+    vector<string> words;
+    std::istringstream stream(text);
+    string word;
+    while (stream >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+BaseAction *BaseAction::fromRecord(const ActionRecord &record, const StringPool &strings, Arena &arena) {
+    const int32_t *values = record.values;
+    BaseAction *action;
+    switch (record.tag) {
+        case STEP_ACTION:
+            action = arena.create<SimulateStep>(values[0]);
+            break;
+        case PLAN_ACTION:
+            action = arena.create<AddPlan>(strings.get(record.strings[0]), strings.get(record.strings[1]));
+            break;
+        case SETTLEMENT_ACTION:
+            action = arena.create<AddSettlement>(strings.get(record.strings[0]), static_cast<SettlementType>(record.option));
+            break;
+        case FACILITY_ACTION:
+            action = arena.create<AddFacility>(strings.get(record.strings[0]), static_cast<FacilityCategory>(record.option),
+                                               values[0], values[1], values[2], values[3]);
+            break;
+        case PLAN_STATUS_ACTION:
+            action = arena.create<PrintPlanStatus>(values[0]);
+            break;
+        case EXPORT_PLANS_ACTION: {
+            Simulation::PlanQuery query;
+            query.firstPlanId = values[0];
+            query.lastPlanId = values[1];
+            query.settlementType = values[2];
+            query.policyType = strings.get(record.strings[0]);
+            action = arena.create<ExportPlansStatus>(query, static_cast<PlanExportFormat>(record.option), strings.get(record.strings[1]));
+            break;
+        }
+        case CHANGE_POLICY_ACTION:
+            action = arena.create<ChangePlanPolicy>(values[0], strings.get(record.strings[0]));
+            break;
+        case COMPARE_POLICIES_ACTION:
+            action = arena.create<ComparePolicies>(values[0], values[1], splitWords(strings.get(record.strings[0])));
+            break;
+        case ACTIONS_LOG_ACTION:
+            action = arena.create<PrintActionsLog>();
+            break;
+        case CLOSE_ACTION:
+            action = arena.create<Close>();
+            break;
+        case BACKUP_ACTION:
+            action = arena.create<BackupSimulation>(strings.get(record.strings[0]));
+            break;
+        case RESTORE_ACTION:
+            action = arena.create<RestoreSimulation>(strings.get(record.strings[0]));
+            break;
+        case MEMORY_ACTION:
+            action = arena.create<PrintMemoryUsage>();
+            break;
+        case SAVE_ACTION:
+            action = arena.create<SaveSimulation>(strings.get(record.strings[0]));
+            break;
+        case LOAD_ACTION:
+            action = arena.create<LoadSimulation>(strings.get(record.strings[0]));
+            break;
+        case STATS_ACTION:
+            action = arena.create<PrintStats>();
+            break;
+        default:
+            throw runtime_error("Unknown action record");
+    }
+    // Set directly: error() would print the message again
+    action->status = record.status == static_cast<uint8_t>(ActionStatus::ERROR) ? ActionStatus::ERROR : ActionStatus::COMPLETED;
+    action->errorMsg = strings.get(record.errorMsg);
+    return action;
+}
+
 // SimulateStep Implementation
 SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {}
 
 void SimulateStep::act(Simulation &simulation) {
-    for (int i = 0; i < numOfSteps; ++i) {
-        simulation.step();
-    }
+    INSTRUMENT_SCOPE("SimulateStep::act");
+    simulation.step(numOfSteps);
     complete();
 }
 
+bool SimulateStep::printsOutput() const {
+    return false;
+}
+
 const string SimulateStep::toString() const {
     return "step " + std::to_string(numOfSteps);
 }
@@ -49,11 +160,17 @@ SimulateStep *SimulateStep::clone() const {
     return new SimulateStep(*this);
 }
 
+void SimulateStep::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = STEP_ACTION;
+    record.values[0] = numOfSteps;
+}
+
 // AddPlan Implementation
 AddPlan::AddPlan(const string &settlementName, const string &selectionPolicy)
     : settlementName(settlementName), selectionPolicy(selectionPolicy) {}
 
 void AddPlan::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("AddPlan::act");
     try {
         simulation.addPlan(settlementName, selectionPolicy);
         complete();
@@ -70,11 +187,18 @@ AddPlan *AddPlan::clone() const {
     return new AddPlan(*this);
 }
 
+void AddPlan::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = PLAN_ACTION;
+    record.strings[0] = strings.intern(settlementName);
+    record.strings[1] = strings.intern(selectionPolicy);
+}
+
 // AddSettlement Implementation
 AddSettlement::AddSettlement(const string &settlementName, SettlementType settlementType)
     : settlementName(settlementName), settlementType(settlementType) {}
 
 void AddSettlement::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("AddSettlement::act");
     try {
         simulation.addSettlement(settlementName, settlementType);
         complete();
@@ -91,6 +215,12 @@ AddSettlement *AddSettlement::clone() const {
     return new AddSettlement(*this);
 }
 
+void AddSettlement::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = SETTLEMENT_ACTION;
+    record.option = static_cast<uint8_t>(settlementType);
+    record.strings[0] = strings.intern(settlementName);
+}
+
 // AddFacility Implementation
 AddFacility::AddFacility(const string &facilityName, const FacilityCategory facilityCategory,
                          const int price, const int lifeQualityScore, const int economyScore,
@@ -99,10 +229,10 @@ AddFacility::AddFacility(const string &facilityName, const FacilityCategory faci
       lifeQualityScore(lifeQualityScore), economyScore(economyScore), environmentScore(environmentScore) {}
 
 void AddFacility::act(Simulation &simulation) {
-    try {
-        simulation.addFacility(facilityName, facilityCategory, price, lifeQualityScore, economyScore, environmentScore);
+    INSTRUMENT_SCOPE("AddFacility::act");
+    if (simulation.addFacility(FacilityType(facilityName, facilityCategory, price, lifeQualityScore, economyScore, environmentScore))) {
         complete();
-    } catch (const runtime_error &e) {
+    } else {
         error("Facility already exists");
     }
 }
@@ -117,10 +247,21 @@ AddFacility *AddFacility::clone() const {
     return new AddFacility(*this);
 }
 
+void AddFacility::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = FACILITY_ACTION;
+    record.option = static_cast<uint8_t>(facilityCategory);
+    record.strings[0] = strings.intern(facilityName);
+    record.values[0] = price;
+    record.values[1] = lifeQualityScore;
+    record.values[2] = economyScore;
+    record.values[3] = environmentScore;
+}
+
 // PrintPlanStatus Implementation
 PrintPlanStatus::PrintPlanStatus(int planId) : planId(planId) {}
 
 void PrintPlanStatus::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("PrintPlanStatus::act");
     try {
         simulation.getPlanStatus(planId);
         complete();
@@ -129,6 +270,10 @@ void PrintPlanStatus::act(Simulation &simulation) {
     }
 }
 
+bool PrintPlanStatus::isReadOnly() const {
+    return true;
+}
+
 const string PrintPlanStatus::toString() const {
     return "planStatus " + std::to_string(planId);
 }
@@ -137,11 +282,68 @@ PrintPlanStatus *PrintPlanStatus::clone() const {
     return new PrintPlanStatus(*this);
 }
 
+void PrintPlanStatus::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = PLAN_STATUS_ACTION;
+    record.values[0] = planId;
+}
+
+// ExportPlansStatus Implementation
+ExportPlansStatus::ExportPlansStatus(const Simulation::PlanQuery &query, PlanExportFormat format, const string &path)
+    : query(query), format(format), path(path) {}
+
+void ExportPlansStatus::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("ExportPlansStatus::act");
+    try {
+        simulation.exportPlansStatus(query, format, path);
+        complete();
+    } catch (const runtime_error &e) {
+        error("Cannot export plan status");
+    }
+}
+
+bool ExportPlansStatus::isReadOnly() const {
+    return true;
+}
+
+const string ExportPlansStatus::toString() const {
+    string result = "planStatus ";
+    if (query.firstPlanId == 0 && query.lastPlanId == INT_MAX) {
+        result += "all";
+    } else {
+        result += std::to_string(query.firstPlanId) + "-" + std::to_string(query.lastPlanId);
+    }
+    if (query.settlementType >= 0) {
+        result += " settlement " + std::to_string(query.settlementType);
+    }
+    if (!query.policyType.empty()) {
+        result += " policy " + query.policyType;
+    }
+    if (!path.empty()) {
+        result += (format == PlanExportFormat::CSV ? " csv " : " columns ") + path;
+    }
+    return result;
+}
+
+ExportPlansStatus *ExportPlansStatus::clone() const {
+    return new ExportPlansStatus(*this);
+}
+
+void ExportPlansStatus::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = EXPORT_PLANS_ACTION;
+    record.option = static_cast<uint8_t>(format);
+    record.values[0] = query.firstPlanId;
+    record.values[1] = query.lastPlanId;
+    record.values[2] = query.settlementType;
+    record.strings[0] = strings.intern(query.policyType);
+    record.strings[1] = strings.intern(path);
+}
+
 // ChangePlanPolicy Implementation
 ChangePlanPolicy::ChangePlanPolicy(const int planId, const string &newPolicy)
     : planId(planId), newPolicy(newPolicy) {}
 
 void ChangePlanPolicy::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("ChangePlanPolicy::act");
     try {
         simulation.changePlanPolicy(planId, newPolicy);
         complete();
@@ -158,14 +360,83 @@ ChangePlanPolicy *ChangePlanPolicy::clone() const {
     return new ChangePlanPolicy(*this);
 }
 
+void ChangePlanPolicy::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = CHANGE_POLICY_ACTION;
+    record.values[0] = planId;
+    record.strings[0] = strings.intern(newPolicy);
+}
+
+// ComparePolicies Implementation
+ComparePolicies::ComparePolicies(const int planId, const int numOfSteps, const vector<string> &policyTypes)
+    : planId(planId), numOfSteps(numOfSteps), policyTypes(policyTypes) {}
+
+void ComparePolicies::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("ComparePolicies::act");
+    vector<Simulation::PolicyOutcome> outcomes;
+    try {
+        outcomes = simulation.comparePolicies(planId, numOfSteps, policyTypes);
+    } catch (const runtime_error &e) {
+        error("Cannot compare selection policies");
+        return;
+    }
+    OutputWriter &out = standardOutput();
+    if (out.getFormat() == OutputFormat::JSON) {
+        for (const Simulation::PolicyOutcome &outcome : outcomes) {
+            out << "{\"type\":\"policyOutcome\",\"planId\":" << planId << ",\"steps\":" << numOfSteps << ",\"policy\":";
+            out.writeJsonString(outcome.policyType);
+            out << ",\"current\":" << (outcome.isCurrent ? "true" : "false")
+                << ",\"lifeQualityScore\":" << outcome.lifeQualityScore << ",\"economyScore\":" << outcome.economyScore
+                << ",\"environmentScore\":" << outcome.environmentScore << "}\n";
+        }
+        complete();
+        return;
+    }
+    out << "PlanID: " << planId << ", after " << numOfSteps << " steps\n";
+    for (const Simulation::PolicyOutcome &outcome : outcomes) {
+        out << "SelectionPolicy: " << outcome.policyType << (outcome.isCurrent ? " (current)" : "")
+            << ", Life Quality Score: " << outcome.lifeQualityScore
+            << ", Economy Score: " << outcome.economyScore
+            << ", Environment Score: " << outcome.environmentScore << '\n';
+    }
+    complete();
+}
+
+const string ComparePolicies::toString() const {
+    string result = "comparePolicies " + std::to_string(planId) + " " + std::to_string(numOfSteps);
+    for (const string &policyType : policyTypes) {
+        result += " " + policyType;
+    }
+    return result;
+}
+
+ComparePolicies *ComparePolicies::clone() const {
+    return new ComparePolicies(*this);
+}
+
+void ComparePolicies::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = COMPARE_POLICIES_ACTION;
+    record.values[0] = planId;
+    record.values[1] = numOfSteps;
+    string joined;
+    for (const string &policyType : policyTypes) {
+        joined += (joined.empty() ? "" : " ") + policyType;
+    }
+    record.strings[0] = strings.intern(joined);
+}
+
 // PrintActionsLog Implementation
 PrintActionsLog::PrintActionsLog() {}
 
 void PrintActionsLog::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("PrintActionsLog::act");
     simulation.printActionsLog();
     complete();
 }
 
+bool PrintActionsLog::isReadOnly() const {
+    return true;
+}
+
 const string PrintActionsLog::toString() const {
     return "log";
 }
@@ -174,10 +445,15 @@ PrintActionsLog *PrintActionsLog::clone() const {
     return new PrintActionsLog(*this);
 }
 
+void PrintActionsLog::recordArguments(ActionRecord &record, StringPool &) const {
+    record.tag = ACTIONS_LOG_ACTION;
+}
+
 // Close Implementation
 Close::Close() {}
 
 void Close::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("Close::act");
     simulation.close();
     complete();
 }
@@ -190,34 +466,164 @@ Close *Close::clone() const {
     return new Close(*this);
 }
 
+void Close::recordArguments(ActionRecord &record, StringPool &) const {
+    record.tag = CLOSE_ACTION;
+}
+
 // BackupSimulation Implementation
-BackupSimulation::BackupSimulation() {}
+BackupSimulation::BackupSimulation() : BackupSimulation("") {}
+
+BackupSimulation::BackupSimulation(const string &checkpointName) : checkpointName(checkpointName) {}
 
 void BackupSimulation::act(Simulation &simulation) {
-    simulation.backup();
+    INSTRUMENT_SCOPE("BackupSimulation::act");
+    if (checkpointName.empty()) {
+        simulation.backup();
+    } else {
+        simulation.backup(checkpointName);
+    }
     complete();
 }
 
 const string BackupSimulation::toString() const {
-    return "backup";
+    return checkpointName.empty() ? "backup" : "backup " + checkpointName;
 }
 
 BackupSimulation *BackupSimulation::clone() const {
     return new BackupSimulation(*this);
 }
 
+void BackupSimulation::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = BACKUP_ACTION;
+    record.strings[0] = strings.intern(checkpointName);
+}
+
 // RestoreSimulation Implementation
-RestoreSimulation::RestoreSimulation() {}
+RestoreSimulation::RestoreSimulation() : RestoreSimulation("") {}
+
+RestoreSimulation::RestoreSimulation(const string &checkpointName) : checkpointName(checkpointName) {}
 
 void RestoreSimulation::act(Simulation &simulation) {
-    simulation.restore();
-    complete();
+    INSTRUMENT_SCOPE("RestoreSimulation::act");
+    try {
+        if (checkpointName.empty()) {
+            simulation.restore();
+        } else {
+            simulation.restore(checkpointName);
+        }
+        complete();
+    } catch (const runtime_error &e) {
+        error(checkpointName.empty() ? "No backup available" : "No checkpoint named " + checkpointName);
+    }
 }
 
 const string RestoreSimulation::toString() const {
-    return "restore";
+    return checkpointName.empty() ? "restore" : "restore " + checkpointName;
 }
 
 RestoreSimulation *RestoreSimulation::clone() const {
     return new RestoreSimulation(*this);
 }
+
+void RestoreSimulation::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = RESTORE_ACTION;
+    record.strings[0] = strings.intern(checkpointName);
+}
+
+// PrintMemoryUsage Implementation
+PrintMemoryUsage::PrintMemoryUsage() {}
+
+void PrintMemoryUsage::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("PrintMemoryUsage::act");
+    simulation.printMemoryUsage();
+    complete();
+}
+
+const string PrintMemoryUsage::toString() const {
+    return "memory";
+}
+
+PrintMemoryUsage *PrintMemoryUsage::clone() const {
+    return new PrintMemoryUsage(*this);
+}
+
+void PrintMemoryUsage::recordArguments(ActionRecord &record, StringPool &) const {
+    record.tag = MEMORY_ACTION;
+}
+
+// SaveSimulation Implementation
+SaveSimulation::SaveSimulation(const string &path) : path(path) {}
+
+void SaveSimulation::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("SaveSimulation::act");
+    try {
+        simulation.saveSnapshot(path);
+        complete();
+    } catch (const runtime_error &e) {
+        error("Cannot save snapshot");
+    }
+}
+
+const string SaveSimulation::toString() const {
+    return "save " + path;
+}
+
+SaveSimulation *SaveSimulation::clone() const {
+    return new SaveSimulation(*this);
+}
+
+void SaveSimulation::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = SAVE_ACTION;
+    record.strings[0] = strings.intern(path);
+}
+
+// LoadSimulation Implementation
+LoadSimulation::LoadSimulation(const string &path) : path(path) {}
+
+void LoadSimulation::act(Simulation &simulation) {
+    INSTRUMENT_SCOPE("LoadSimulation::act");
+    try {
+        simulation.loadSnapshot(path);
+        complete();
+    } catch (const runtime_error &e) {
+        error("Cannot load snapshot");
+    }
+}
+
+const string LoadSimulation::toString() const {
+    return "load " + path;
+}
+
+LoadSimulation *LoadSimulation::clone() const {
+    return new LoadSimulation(*this);
+}
+
+void LoadSimulation::recordArguments(ActionRecord &record, StringPool &strings) const {
+    record.tag = LOAD_ACTION;
+    record.strings[0] = strings.intern(path);
+}
+
+// PrintStats Implementation
+PrintStats::PrintStats() {}
+
+void PrintStats::act(Simulation &) {
+    INSTRUMENT_SCOPE("PrintStats::act");
+    printInstrumentation(standardOutput());
+    complete();
+}
+
+bool PrintStats::isReadOnly() const {
+    return true;
+}
+
+const string PrintStats::toString() const {
+    return "stats";
+}
+
+PrintStats *PrintStats::clone() const {
+    return new PrintStats(*this);
+}
+
+void PrintStats::recordArguments(ActionRecord &record, StringPool &) const {
+    record.tag = STATS_ACTION;
+}
@@ -0,0 +1,123 @@
+#include "ActionsLog.h"
+#include "Action.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <stdexcept>
+
+const size_t ActionsLog::BLOCK_SIZE;
+
+ActionRecord::ActionRecord() : tag(0), status(0), option(0), values(), strings(), errorMsg(StringPool::EMPTY) {}
+
+ActionsLog::ActionsLog() : sealed(), tail(), strings(std::make_shared<StringPool>()), limit(0) {
+    tail.write().reserve(BLOCK_SIZE);
+}
+
+void ActionsLog::add(const BaseAction &action) {
+    append(action.record(*strings));
+}
+
+void ActionsLog::append(const ActionRecord &record) {
+    Block &block = tail.write();
+    block.push_back(record);
+    if (block.size() == BLOCK_SIZE) {
+        sealed.write().push_back(std::make_shared<const Block>(std::move(block)));
+        tail = CowPointer<Block>();
+        tail.write().reserve(BLOCK_SIZE);
+        dropOldBlocks();
+    }
+}
+
+// Drops the oldest full blocks for as long as the blocks after them hold limit actions
+void ActionsLog::dropOldBlocks() {
+    if (limit == 0) {
+        return;
+    }
+    size_t droppable = 0;
+    while (droppable < sealed->size() && (sealed->size() - droppable - 1) * BLOCK_SIZE + tail->size() >= limit) {
+        ++droppable;
+    }
+    if (droppable > 0) {
+        vector<shared_ptr<const Block>> &blocks = sealed.write();
+        blocks.erase(blocks.begin(), blocks.begin() + droppable);
+    }
+}
+
+size_t ActionsLog::getRecordCount() const {
+    return sealed->size() * BLOCK_SIZE + tail->size();
+}
+
+size_t ActionsLog::size() const {
+    size_t count = getRecordCount();
+    return limit == 0 ? count : std::min(count, limit);
+}
+
+const ActionRecord &ActionsLog::getRecord(size_t index) const {
+    size_t position = getRecordCount() - size() + index;
+    size_t block = position / BLOCK_SIZE;
+    if (block < sealed->size()) {
+        return (*(*sealed)[block])[position % BLOCK_SIZE];
+    }
+    return (*tail)[position - sealed->size() * BLOCK_SIZE];
+}
+
+BaseAction *ActionsLog::get(size_t index, Arena &arena) const {
+    return BaseAction::fromRecord(getRecord(index), *strings, arena);
+}
+
+void ActionsLog::setLimit(size_t limit) {
+    this->limit = limit;
+    dropOldBlocks();
+}
+
+size_t ActionsLog::getLimit() const {
+    return limit;
+}
+
+// Each record as its fields in order, with its strings written out rather than as IDs
+void ActionsLog::save(SnapshotWriter &writer) const {
+    writer.writeSize(size());
+    for (size_t i = 0; i < size(); ++i) {
+        const ActionRecord &record = getRecord(i);
+        writer.writeByte(record.tag);
+        writer.writeByte(record.status);
+        writer.writeByte(record.option);
+        writer.writeArray(record.values, 4);
+        writer.writeString(strings->get(record.strings[0]));
+        writer.writeString(strings->get(record.strings[1]));
+        writer.writeString(strings->get(record.errorMsg));
+    }
+}
+
+void ActionsLog::load(SnapshotReader &reader) {
+    size_t count = reader.readCount(3 + 4 * sizeof(int32_t) + 3 * sizeof(uint64_t));
+    Arena scratch;
+    for (size_t i = 0; i < count; ++i) {
+        ActionRecord record;
+        record.tag = reader.readByte();
+        record.status = reader.readByte();
+        record.option = reader.readByte();
+        reader.readArray(record.values, 4);
+        record.strings[0] = strings->intern(reader.readString());
+        record.strings[1] = strings->intern(reader.readString());
+        record.errorMsg = strings->intern(reader.readString());
+        BaseAction::fromRecord(record, *strings, scratch); //Throws on a record that names no action
+        scratch.reset();
+        append(record);
+    }
+}
+
+size_t ActionsLog::getBytesUsed() const {
+    return getRecordCount() * sizeof(ActionRecord);
+}
+
+size_t ActionsLog::getBytesReserved() const {
+    return (sealed->size() * BLOCK_SIZE + tail->capacity()) * sizeof(ActionRecord);
+}
+
+size_t ActionsLog::getStringCount() const {
+    return strings->size();
+}
+
+size_t ActionsLog::getStringBytes() const {
+    return strings->getBytesUsed();
+}
@@ -0,0 +1,80 @@
+#include "Arena.h"
+#include <cstdint>
+
+const size_t Arena::DEFAULT_BLOCK_SIZE;
+
+Arena::Arena(size_t blockSize)
+    : blockSize(blockSize), blocks(), blockSizes(), cursor(nullptr), blockEnd(nullptr), bytesUsed(0), bytesReserved(0),
+      destructors() {}
+
+Arena::~Arena() {
+    release();
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(cursor);
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (cursor == nullptr || padding + size > static_cast<size_t>(blockEnd - cursor)) {
+        // Oversized objects get a block of their own
+        size_t newBlockSize = (size + alignment > blockSize) ? size + alignment : blockSize;
+        char *block = static_cast<char *>(::operator new(newBlockSize));
+        blocks.push_back(block);
+        blockSizes.push_back(newBlockSize);
+        bytesReserved += newBlockSize;
+        cursor = block;
+        blockEnd = block + newBlockSize;
+        address = reinterpret_cast<std::uintptr_t>(cursor);
+        padding = (alignment - address % alignment) % alignment;
+    }
+    void *memory = cursor + padding;
+    cursor += padding + size;
+    bytesUsed += padding + size;
+    return memory;
+}
+
+void Arena::destroyObjects() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+    bytesUsed = 0;
+}
+
+void Arena::release() {
+    destroyObjects();
+    for (char *block : blocks) {
+        ::operator delete(block);
+    }
+    blocks.clear();
+    blockSizes.clear();
+    cursor = nullptr;
+    blockEnd = nullptr;
+    bytesReserved = 0;
+}
+
+void Arena::reset() {
+    destroyObjects();
+    if (blocks.empty()) {
+        return;
+    }
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        ::operator delete(blocks[i]);
+    }
+    blocks.resize(1);
+    blockSizes.resize(1);
+    bytesReserved = blockSizes[0];
+    cursor = blocks[0];
+    blockEnd = blocks[0] + blockSizes[0];
+}
+
+size_t Arena::getObjectCount() const {
+    return destructors.size();
+}
+
+size_t Arena::getBytesUsed() const {
+    return bytesUsed;
+}
+
+size_t Arena::getBytesReserved() const {
+    return bytesReserved;
+}
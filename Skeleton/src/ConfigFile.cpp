@@ -0,0 +1,141 @@
+#include "ConfigFile.h"
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t ConfigFile::MAX_TOKENS;
+
+bool TokenView::equals(const char *text) const {
+    return std::strlen(text) == length && std::memcmp(data, text, length) == 0;
+}
+
+string TokenView::str() const {
+    return string(data, length);
+}
+
+ConfigFile::ConfigFile(const string &path) : data(nullptr), size(0), position(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open configuration file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to open configuration file: " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to open configuration file: " + path);
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+ConfigFile::~ConfigFile() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+    }
+}
+
+const char *ConfigFile::getData() const {
+    return data;
+}
+
+size_t ConfigFile::getSize() const {
+    return size;
+}
+
+bool ConfigFile::nextLine(TokenView &line) {
+    return ::nextLine(data, size, position, line);
+}
+
+size_t alignToLine(const char *data, size_t size, size_t position) {
+    if (position == 0) {
+        return 0;
+    }
+    if (position >= size) {
+        return size;
+    }
+    const char *newline = static_cast<const char *>(std::memchr(data + position - 1, '\n', size - position + 1));
+    return newline ? static_cast<size_t>(newline - data) + 1 : size;
+}
+
+bool nextLine(const char *data, size_t end, size_t &position, TokenView &line) {
+    if (position >= end) {
+        return false;
+    }
+    const char *start = data + position;
+    const char *newline = static_cast<const char *>(std::memchr(start, '\n', end - position));
+    size_t length = newline ? static_cast<size_t>(newline - start) : end - position;
+    line.data = start;
+    line.length = length;
+    position += length + 1;
+    return true;
+}
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+size_t tokenize(const TokenView &line, TokenView *tokens, size_t maxTokens) {
+    size_t count = 0;
+    const char *current = line.data;
+    const char *end = line.data + line.length;
+    while (count < maxTokens) {
+        while (current < end && isSpace(*current)) {
+            ++current;
+        }
+        if (current == end) {
+            break;
+        }
+        const char *tokenStart = current;
+        while (current < end && !isSpace(*current)) {
+            ++current;
+        }
+        tokens[count].data = tokenStart;
+        tokens[count].length = static_cast<size_t>(current - tokenStart);
+        ++count;
+    }
+    return count;
+}
+
+bool parseInt(const TokenView &token, int &value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < token.length && (token.data[i] == '-' || token.data[i] == '+')) {
+        negative = token.data[i] == '-';
+        ++i;
+    }
+    if (i == token.length) {
+        return false;
+    }
+    long long result = 0;
+    for (; i < token.length; ++i) {
+        char c = token.data[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + (c - '0');
+        if (result > static_cast<long long>(INT_MAX) + 1) {
+            return false;
+        }
+    }
+    if (negative) {
+        result = -result;
+    }
+    if (result > INT_MAX || result < INT_MIN) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
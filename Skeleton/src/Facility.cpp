@@ -30,6 +30,10 @@ FacilityCategory FacilityType::getCategory() const {
 Facility::Facility(const FacilityType &type, const string &settlementName): FacilityType(type), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(type.getCost()) {}
 Facility::Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score): FacilityType(name, category, price, lifeQuality_score, economy_score, environment_score),settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(price) {}
 
+const string &Facility::getSettlementName() const {
+    return settlementName;
+}
+
 const int Facility::getTimeLeft() const {
     return timeLeft;
 }
@@ -44,6 +48,17 @@ FacilityStatus Facility::step() {
 
     return status;
 }
+// Same as calling step() `steps` times
+FacilityStatus Facility::advance(int steps) {
+    if (steps <= 0) {
+        return status;
+    }
+    timeLeft = (timeLeft > steps) ? timeLeft - steps : 0;
+    if (timeLeft == 0) {
+        status = FacilityStatus::OPERATIONAL;
+    }
+    return status;
+}
 void Facility::setStatus(FacilityStatus newStatus) {
     status = newStatus;
 }
@@ -51,5 +66,7 @@ const FacilityStatus& Facility::getStatus() const {
     return status;
 }
 
-
-
+const string Facility::toString() const {
+    return "FacilityName: " + name + ", SettlementName: " + settlementName + ", FacilityStatus: " +
+           ((status == FacilityStatus::OPERATIONAL) ? "OPERATIONAL" : "UNDER_CONSTRUCTIONS");
+}
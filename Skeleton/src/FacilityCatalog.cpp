@@ -0,0 +1,80 @@
+#include "FacilityCatalog.h"
+#include <utility>
+
+const FacilityId FacilityCatalog::NO_FACILITY;
+
+FacilityCatalog::FacilityCatalog()
+    : types(), ids(), categories(), balanceGroups(), balanceGroupIndex() {}
+
+// FacilityType has const members and can't be assigned, so copy and swap the containers instead
+FacilityCatalog &FacilityCatalog::operator=(const FacilityCatalog &other) {
+    if (this != &other) {
+        FacilityCatalog copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+void FacilityCatalog::swap(FacilityCatalog &other) {
+    types.swap(other.types);
+    ids.swap(other.ids);
+    for (int category = 0; category < 3; ++category) {
+        categories[category].swap(other.categories[category]);
+    }
+    std::swap(balanceGroups, other.balanceGroups);
+    balanceGroupIndex.swap(other.balanceGroupIndex);
+}
+
+// Registers a new facility type. Returns NO_FACILITY if the name is already taken.
+FacilityId FacilityCatalog::add(const FacilityType &facilityType) {
+    FacilityId id = static_cast<FacilityId>(types.size());
+    if (!ids.emplace(facilityType.getName(), id).second) {
+        return NO_FACILITY;
+    }
+    types.push_back(facilityType);
+    categories[static_cast<int>(facilityType.getCategory())].push_back(id);
+
+    int economyOffset = facilityType.getEconomyScore() - facilityType.getLifeQualityScore();
+    int environmentOffset = facilityType.getEnvironmentScore() - facilityType.getLifeQualityScore();
+    unsigned long long key = (static_cast<unsigned long long>(static_cast<unsigned int>(economyOffset)) << 32) |
+                             static_cast<unsigned int>(environmentOffset);
+    if (balanceGroupIndex.emplace(key, balanceGroups.firstIds.size()).second) {
+        balanceGroups.economyOffsets.push_back(economyOffset);
+        balanceGroups.environmentOffsets.push_back(environmentOffset);
+        balanceGroups.firstIds.push_back(id);
+    }
+    return id;
+}
+
+FacilityId FacilityCatalog::find(const string &name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? NO_FACILITY : it->second;
+}
+
+bool FacilityCatalog::contains(const string &name) const {
+    return ids.count(name) != 0;
+}
+
+const FacilityType &FacilityCatalog::get(FacilityId id) const {
+    return types[id];
+}
+
+const vector<FacilityType> &FacilityCatalog::getTypes() const {
+    return types;
+}
+
+const vector<FacilityId> &FacilityCatalog::getCategory(FacilityCategory category) const {
+    return categories[static_cast<int>(category)];
+}
+
+const BalanceGroups &FacilityCatalog::getBalanceGroups() const {
+    return balanceGroups;
+}
+
+size_t FacilityCatalog::size() const {
+    return types.size();
+}
+
+bool FacilityCatalog::empty() const {
+    return types.empty();
+}
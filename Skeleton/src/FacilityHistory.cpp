@@ -0,0 +1,45 @@
+#include "FacilityHistory.h"
+#include <algorithm>
+#include <utility>
+
+const size_t FacilityHistory::CHUNK_SIZE;
+
+FacilityHistory::FacilityHistory() : sealed(), tail() {}
+
+void FacilityHistory::push_back(FacilityId facilityType) {
+    if (tail.size() == CHUNK_SIZE) {
+        sealed.push_back(std::make_shared<const vector<FacilityId>>(std::move(tail)));
+        tail.clear();
+    }
+    if (tail.empty()) {
+        tail.reserve(CHUNK_SIZE);
+    }
+    tail.push_back(facilityType);
+}
+
+// Fills the tail up to the end of its chunk at a time, with the chunk checks done once per chunk
+void FacilityHistory::append(const FacilityId *facilityTypes, size_t count) {
+    const FacilityId *end = facilityTypes + count;
+    while (facilityTypes != end) {
+        if (tail.size() == CHUNK_SIZE) {
+            sealed.push_back(std::make_shared<const vector<FacilityId>>(std::move(tail)));
+            tail.clear();
+        }
+        if (tail.empty()) {
+            tail.reserve(CHUNK_SIZE);
+        }
+        const FacilityId *chunkEnd = facilityTypes + std::min(static_cast<size_t>(end - facilityTypes), CHUNK_SIZE - tail.size());
+        while (facilityTypes != chunkEnd) {
+            tail.push_back(*facilityTypes++);
+        }
+    }
+}
+
+size_t FacilityHistory::size() const {
+    return sealed.size() * CHUNK_SIZE + tail.size();
+}
+
+FacilityId FacilityHistory::operator[](size_t slot) const {
+    size_t chunk = slot / CHUNK_SIZE;
+    return chunk < sealed.size() ? (*sealed[chunk])[slot % CHUNK_SIZE] : tail[slot - sealed.size() * CHUNK_SIZE];
+}
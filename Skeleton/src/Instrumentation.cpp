@@ -0,0 +1,261 @@
+#include "Instrumentation.h"
+#include "OutputWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+const size_t Probe::MAX_PROBES;
+const unsigned Probe::HOT_SAMPLE_INTERVAL;
+const uint64_t ScopedTimer::NOT_TIMED;
+
+// Call times go in buckets of a quarter octave: exact below 8 ns, then four buckets for each
+// power of two, so a percentile read off the buckets is at most 25% high
+static const size_t BUCKET_COUNT = 252;
+
+static size_t bucketOf(uint64_t nanoseconds) {
+    if (nanoseconds < 8) {
+        return static_cast<size_t>(nanoseconds);
+    }
+    size_t octave = 63 - static_cast<size_t>(__builtin_clzll(nanoseconds));
+    return (octave - 1) * 4 + ((nanoseconds >> (octave - 2)) & 3);
+}
+
+static uint64_t bucketLimit(size_t bucket) { //Largest time in bucket
+    if (bucket < 8) {
+        return bucket;
+    }
+    size_t octave = bucket / 4 + 1;
+    uint64_t width = uint64_t(1) << (octave - 2);
+    return (4 + bucket % 4) * width + width - 1;
+}
+
+// Counters of one thread. Only that thread writes them, so an update is a plain load and
+// store; they are atomic so that the stats command can read them while the thread runs.
+struct ProbeCounters {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> timedCalls;
+    std::atomic<uint64_t> timedNanoseconds;
+    std::atomic<uint64_t> buckets[BUCKET_COUNT]; //Of the timed calls
+    unsigned untilTimed; //Calls to skip before timing one; only this thread reads it
+};
+
+struct ThreadCounters {
+    ProbeCounters probes[Probe::MAX_PROBES];
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> allocatedBytes;
+};
+
+static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct Registry {
+    Registry() : mutex(), probeNames(), threads() {}
+    std::mutex mutex;
+    vector<const char *> probeNames;
+    vector<ThreadCounters *> threads; //Never freed: the counters of finished threads still count
+};
+
+// Built in place and never destroyed, as operator new may use it before and after main
+static Registry &registry() {
+    static std::aligned_storage<sizeof(Registry), alignof(Registry)>::type storage;
+    static Registry *instance = new (&storage) Registry();
+    return *instance;
+}
+
+static thread_local ThreadCounters *currentCounters = nullptr;
+
+// Set before registering, since registering allocates and operator new counts through this
+static ThreadCounters *threadCounters() {
+    if (currentCounters == nullptr) {
+        void *memory = std::calloc(1, sizeof(ThreadCounters));
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        currentCounters = new (memory) ThreadCounters();
+        Registry &instance = registry();
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        instance.threads.push_back(currentCounters);
+    }
+    return currentCounters;
+}
+
+Probe::Probe(const char *name, unsigned sampleInterval) : index(0), sampleInterval(std::max(sampleInterval, 1u)) {
+    threadCounters(); //Registers this thread first, as registering takes the mutex held below
+    Registry &instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    if (instance.probeNames.size() == MAX_PROBES) {
+        throw std::logic_error("Too many instrumentation probes");
+    }
+    index = instance.probeNames.size();
+    instance.probeNames.push_back(name);
+}
+
+bool Probe::begin() const {
+    ProbeCounters &counters = threadCounters()->probes[index];
+    add(counters.calls, 1);
+    if (counters.untilTimed != 0) {
+        --counters.untilTimed;
+        return false;
+    }
+    if (sampleInterval > 1 && counters.calls.load(std::memory_order_relaxed) == 1) {
+        return false; //The first call on a thread sets up the probes it runs into, so the second is timed
+    }
+    counters.untilTimed = sampleInterval - 1;
+    return true;
+}
+
+void Probe::end(uint64_t nanoseconds) const {
+    ProbeCounters &counters = threadCounters()->probes[index];
+    add(counters.timedCalls, 1);
+    add(counters.timedNanoseconds, nanoseconds);
+    add(counters.buckets[bucketOf(nanoseconds)], 1);
+}
+
+#ifndef NO_INSTRUMENTATION
+static void *countedAllocation(size_t size) {
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory != nullptr) {
+        ThreadCounters *counters = threadCounters();
+        add(counters->allocations, 1);
+        add(counters->allocatedBytes, size);
+    }
+    return memory;
+}
+
+void *operator new(size_t size) {
+    void *memory = countedAllocation(size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocation(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocation(size);
+}
+
+// Out of line, so the compiler doesn't take free() inlined into a delete for a mismatch
+__attribute__((noinline)) static void releaseAllocation(void *memory) {
+    std::free(memory);
+}
+
+void operator delete(void *memory) noexcept {
+    releaseAllocation(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    releaseAllocation(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    releaseAllocation(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    releaseAllocation(memory);
+}
+#endif
+
+// Totals of one probe over all threads
+struct ProbeTotals {
+    ProbeTotals() : name(), calls(0), timedCalls(0), timedNanoseconds(0), buckets(BUCKET_COUNT, 0) {}
+    string name;
+    uint64_t calls;
+    uint64_t timedCalls;
+    uint64_t timedNanoseconds;
+    vector<uint64_t> buckets;
+
+    uint64_t totalNanoseconds() const { //Estimated from the timed calls if not all were
+        return timedCalls == 0 ? 0 : static_cast<uint64_t>(static_cast<double>(timedNanoseconds) * calls / timedCalls);
+    }
+
+    uint64_t percentile(double fraction) const {
+        uint64_t wanted = static_cast<uint64_t>(fraction * timedCalls);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            seen += buckets[bucket];
+            if (seen > wanted || seen == timedCalls) {
+                return bucketLimit(bucket);
+            }
+        }
+        return 0;
+    }
+};
+
+void printInstrumentation(OutputWriter &out) {
+    bool json = out.getFormat() == OutputFormat::JSON;
+#ifdef NO_INSTRUMENTATION
+    out << (json ? "{\"type\":\"stats\",\"enabled\":false}\n" : "Instrumentation is compiled out\n");
+    return;
+#endif
+    vector<ProbeTotals> totals;
+    uint64_t allocations = 0, allocatedBytes = 0;
+    {
+        threadCounters();
+        Registry &instance = registry();
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        totals.resize(instance.probeNames.size());
+        for (size_t probe = 0; probe < totals.size(); ++probe) {
+            totals[probe].name = instance.probeNames[probe];
+        }
+        for (const ThreadCounters *thread : instance.threads) {
+            for (size_t probe = 0; probe < totals.size(); ++probe) {
+                const ProbeCounters &counters = thread->probes[probe];
+                totals[probe].calls += counters.calls.load(std::memory_order_relaxed);
+                totals[probe].timedCalls += counters.timedCalls.load(std::memory_order_relaxed);
+                totals[probe].timedNanoseconds += counters.timedNanoseconds.load(std::memory_order_relaxed);
+                for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+                    totals[probe].buckets[bucket] += counters.buckets[bucket].load(std::memory_order_relaxed);
+                }
+            }
+            allocations += thread->allocations.load(std::memory_order_relaxed);
+            allocatedBytes += thread->allocatedBytes.load(std::memory_order_relaxed);
+        }
+    }
+    std::sort(totals.begin(), totals.end(), [](const ProbeTotals &left, const ProbeTotals &right) {
+        return left.name < right.name;
+    });
+
+    for (const ProbeTotals &probe : totals) {
+        if (probe.calls == 0) {
+            continue;
+        }
+        size_t total = static_cast<size_t>(probe.totalNanoseconds());
+        size_t mean = probe.timedCalls == 0 ? 0 : static_cast<size_t>(probe.timedNanoseconds / probe.timedCalls);
+        size_t p99 = static_cast<size_t>(probe.percentile(0.99));
+        if (json) {
+            out << "{\"type\":\"stats\",\"probe\":";
+            out.writeJsonString(probe.name);
+            out << ",\"calls\":" << static_cast<size_t>(probe.calls) << ",\"totalNs\":" << total
+                << ",\"meanNs\":" << mean << ",\"p99Ns\":" << p99 << "}\n";
+        } else {
+            out << probe.name << ": " << static_cast<size_t>(probe.calls) << " calls, "
+                << total << " ns total, " << mean << " ns mean, "
+                << p99 << " ns p99\n";
+        }
+    }
+    if (json) {
+        out << "{\"type\":\"allocations\",\"count\":" << static_cast<size_t>(allocations)
+            << ",\"bytes\":" << static_cast<size_t>(allocatedBytes) << "}\n";
+    } else {
+        out << "Allocations: " << static_cast<size_t>(allocations) << " (" << static_cast<size_t>(allocatedBytes) << " bytes)\n";
+    }
+}
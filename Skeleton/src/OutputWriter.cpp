@@ -0,0 +1,128 @@
+#include "OutputWriter.h"
+#include "Instrumentation.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+const size_t OutputWriter::BLOCK_SIZE;
+
+OutputWriter::OutputWriter(int fd) : fd(fd), buffer(), format(OutputFormat::TEXT), writeCount(0), failed(false) {
+    buffer.reserve(BLOCK_SIZE);
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+}
+
+void OutputWriter::write(const char *data, size_t length) {
+    buffer.insert(buffer.end(), data, data + length);
+    if (buffer.size() >= BLOCK_SIZE) {
+        flush();
+    }
+}
+
+OutputWriter &OutputWriter::operator<<(const string &text) {
+    write(text.data(), text.size());
+    return *this;
+}
+
+OutputWriter &OutputWriter::operator<<(const char *text) {
+    write(text, std::strlen(text));
+    return *this;
+}
+
+OutputWriter &OutputWriter::operator<<(char character) {
+    write(&character, 1);
+    return *this;
+}
+
+OutputWriter &OutputWriter::operator<<(int value) {
+    return *this << static_cast<long long>(value);
+}
+
+OutputWriter &OutputWriter::operator<<(long long value) {
+    if (value < 0) {
+        *this << '-';
+        writeUnsigned(0ULL - static_cast<unsigned long long>(value));
+    } else {
+        writeUnsigned(static_cast<unsigned long long>(value));
+    }
+    return *this;
+}
+
+OutputWriter &OutputWriter::operator<<(size_t value) {
+    writeUnsigned(value);
+    return *this;
+}
+
+void OutputWriter::writeUnsigned(unsigned long long value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - ++count] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    write(digits + sizeof(digits) - count, count);
+}
+
+void OutputWriter::writeJsonString(const string &text) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    *this << '"';
+    size_t plainStart = 0; //Start of the run of characters that need no escape
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char code = static_cast<unsigned char>(text[i]);
+        if (code >= 0x20 && code != '"' && code != '\\') {
+            continue;
+        }
+        write(text.data() + plainStart, i - plainStart);
+        plainStart = i + 1;
+        if (code >= 0x20) {
+            *this << '\\' << text[i];
+        } else {
+            char escape[] = {'\\', 'u', '0', '0', HEX_DIGITS[code >> 4], HEX_DIGITS[code & 0xF]};
+            write(escape, sizeof(escape));
+        }
+    }
+    write(text.data() + plainStart, text.size() - plainStart);
+    *this << '"';
+}
+
+// Write errors are only recorded, as they are for std::cout
+void OutputWriter::flush() {
+    INSTRUMENT_SCOPE("OutputWriter::flush");
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t result = ::write(fd, buffer.data() + written, buffer.size() - written);
+        ++writeCount;
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            failed = true;
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    buffer.clear();
+}
+
+OutputFormat OutputWriter::getFormat() const {
+    return format;
+}
+
+void OutputWriter::setFormat(OutputFormat format) {
+    this->format = format;
+}
+
+size_t OutputWriter::getWriteCount() const {
+    return writeCount;
+}
+
+bool OutputWriter::hasFailed() const {
+    return failed;
+}
+
+OutputWriter &standardOutput() {
+    static OutputWriter writer(STDOUT_FILENO);
+    return writer;
+}
@@ -1,13 +1,106 @@
 #include "Plan.h"
+#include "Instrumentation.h"
+#include "OutputWriter.h"
+#include "Snapshot.h"
 #include <stdexcept>
 #include <algorithm>
-#include <iostream> 
 #include <string>
+#include <climits>
 
-Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
+const int Plan::NO_EVENT = INT_MAX;
+const int Plan::MAX_CONSTRUCTION_LIMIT;
+
+Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy)
     : plan_id(planId), settlement(&settlement), selectionPolicy(selectionPolicy), status(PlanStatus::AVAILABLE),
-      facilityOptions(facilityOptions), life_quality_score(0), economy_score(0), environment_score(0),
-      facilities(), underConstruction() {}
+      life_quality_score(0), economy_score(0), environment_score(0),
+      facilities(), underConstruction(), failedSelectionOptions(string::npos) {}
+
+Plan::Plan(const Plan &other)
+    : plan_id(other.plan_id), settlement(other.settlement), selectionPolicy(other.selectionPolicy->clone()), status(other.status),
+      facilities(other.facilities), underConstruction(other.underConstruction), life_quality_score(other.life_quality_score),
+      economy_score(other.economy_score), environment_score(other.environment_score),
+      failedSelectionOptions(other.failedSelectionOptions) {}
+
+Plan::Plan(Plan &&other) noexcept
+    : plan_id(other.plan_id), settlement(other.settlement), selectionPolicy(other.selectionPolicy), status(other.status),
+      facilities(std::move(other.facilities)), underConstruction(std::move(other.underConstruction)),
+      life_quality_score(other.life_quality_score), economy_score(other.economy_score),
+      environment_score(other.environment_score), failedSelectionOptions(other.failedSelectionOptions) {
+    other.selectionPolicy = nullptr;
+}
+
+// Reads a plan written by save, in a simulation at tick now. Facility ids are checked against facilityOptions.
+Plan::Plan(SnapshotReader &reader, const Settlement &settlement, const FacilityCatalog &facilityOptions, Tick now)
+    : plan_id(reader.readInt()), settlement(&settlement), selectionPolicy(nullptr), status(PlanStatus::AVAILABLE),
+      facilities(), underConstruction(), life_quality_score(0), economy_score(0), environment_score(0), failedSelectionOptions(string::npos) {
+    uint8_t savedStatus = reader.readByte();
+    if (savedStatus > static_cast<uint8_t>(PlanStatus::BUSY)) {
+        throw std::runtime_error("Invalid plan status in snapshot");
+    }
+    status = static_cast<PlanStatus>(savedStatus);
+    life_quality_score = reader.readInt();
+    economy_score = reader.readInt();
+    environment_score = reader.readInt();
+    failedSelectionOptions = static_cast<size_t>(reader.readSize());
+
+    size_t facilityCount = reader.readCount(sizeof(FacilityId));
+    vector<FacilityId> facilityTypes(facilityCount);
+    reader.readArray(facilityTypes.data(), facilityCount);
+    for (FacilityId facilityType : facilityTypes) {
+        if (facilityType < 0 || static_cast<size_t>(facilityType) >= facilityOptions.size()) {
+            throw std::runtime_error("Invalid facility in snapshot");
+        }
+        facilities.push_back(facilityType);
+    }
+    size_t constructionCount = reader.readCount(2 * sizeof(uint64_t));
+    if (constructionCount > static_cast<size_t>(MAX_CONSTRUCTION_LIMIT)) {
+        throw std::runtime_error("Invalid plan in snapshot");
+    }
+    for (size_t i = 0; i < constructionCount; ++i) {
+        uint64_t slot = reader.readSize();
+        Tick doneTick = static_cast<Tick>(reader.readSize());
+        // Slots are started in order, and anything due by now would have been completed
+        if (slot >= facilityCount || (!underConstruction.empty() && slot <= underConstruction.back().slot) || doneTick <= now) {
+            throw std::runtime_error("Invalid plan in snapshot");
+        }
+        underConstruction.push_back(Construction{static_cast<size_t>(slot), doneTick});
+    }
+    selectionPolicy = SelectionPolicy::load(reader);
+}
+
+void Plan::save(SnapshotWriter &writer) const {
+    writer.writeInt(plan_id);
+    writer.writeByte(static_cast<uint8_t>(status));
+    writer.writeInt(life_quality_score);
+    writer.writeInt(economy_score);
+    writer.writeInt(environment_score);
+    writer.writeSize(failedSelectionOptions);
+
+    vector<FacilityId> facilityTypes(facilities.size());
+    for (size_t slot = 0; slot < facilityTypes.size(); ++slot) {
+        facilityTypes[slot] = facilities[slot];
+    }
+    writer.writeSize(facilityTypes.size());
+    writer.writeArray(facilityTypes.data(), facilityTypes.size());
+    writer.writeSize(underConstruction.size());
+    for (const Construction &construction : underConstruction) {
+        writer.writeSize(construction.slot);
+        writer.writeSize(static_cast<uint64_t>(construction.doneTick));
+    }
+    selectionPolicy->save(writer);
+}
+
+Plan::~Plan() {
+    delete selectionPolicy;
+}
+
+const Settlement &Plan::getSettlement() const {
+    return *settlement;
+}
+
+const SelectionPolicy &Plan::getSelectionPolicy() const {
+    return *selectionPolicy;
+}
 
 
 const int Plan::getLifeQualityScore() const {
@@ -23,64 +116,155 @@ const int Plan::getPlanID() const{
 const int Plan::getEnvironmentScore() const {
     return environment_score;
 }
+
+PlanStatus Plan::getStatus() const {
+    return status;
+}
+
 void Plan::setSelectionPolicy(SelectionPolicy *newSelectionPolicy) {
     if (selectionPolicy != newSelectionPolicy) {
+        delete selectionPolicy;
         selectionPolicy = newSelectionPolicy;
+        failedSelectionOptions = string::npos;
     }
 }
 
-void Plan::step() {
+int Plan::constructionLimit() const {
     SettlementType type =settlement->getType();
-    int limit = 0;
     if(type == SettlementType::VILLAGE)
-        limit = 1;
-    else {
-        if(type == SettlementType::CITY)
-            limit = 2;
-        else
-            limit = 3;
-        }
+        return 1;
+    if(type == SettlementType::CITY)
+        return 2;
+    return MAX_CONSTRUCTION_LIMIT;
+}
+
+void Plan::step(const FacilityCatalog &facilityOptions, Tick now) {
+    INSTRUMENT_HOT_SCOPE("Plan::step");
+    int limit = constructionLimit();
     // Step 2: Start new facility construction
-    if (status == PlanStatus::AVAILABLE) {
-        while (underConstruction.size() < static_cast<size_t>(limit)) {
-            try {
-                const FacilityType &selected = selectionPolicy->selectFacility(facilityOptions);
-                Facility *newFacility = new Facility(selected, settlement->getName());
-                underConstruction.push_back(newFacility);
-            } catch (std::exception &e) {
-                // No more facilities can be selected
-                break;
-            }
+    if (status == PlanStatus::AVAILABLE && underConstruction.size() < static_cast<size_t>(limit)) {
+        INSTRUMENT_HOT_SCOPE("Plan::step selection");
+        FacilityId selected[MAX_CONSTRUCTION_LIMIT];
+        int freeSlots = limit - static_cast<int>(underConstruction.size());
+        int selectedCount = selectionPolicy->selectFacilities(facilityOptions, freeSlots, selected);
+        size_t firstSlot = facilities.size();
+        facilities.append(selected, static_cast<size_t>(selectedCount));
+        for (int i = 0; i < selectedCount; ++i) {
+            // A facility takes at least the step it is started in
+            int duration = std::max(facilityOptions.get(selected[i]).getCost(), 1);
+            underConstruction.push_back(Construction{firstSlot + i, now + duration - 1});
+        }
+        if (selectedCount < freeSlots) {
+            // No more facilities can be selected until the options or the policy change
+            failedSelectionOptions = facilityOptions.size();
         }
     }
 
     // Step 3: Update facilities under construction
-    for (auto it = underConstruction.begin(); it != underConstruction.end();) {
-        (*it)->step();
-        if ((*it)->getTimeLeft() == 0) {
-            facilities.push_back(*it);
+    completeConstructions(facilityOptions, now);
 
-            // Update plan scores
-            life_quality_score += (*it)->getLifeQualityScore();
-            economy_score += (*it)->getEnvironmentScore();
-            environment_score += (*it)->getEconomyScore();
+    // Step 4: Update plan status
+    status = (underConstruction.size() == limit) ? PlanStatus::BUSY : PlanStatus::AVAILABLE;
+}
 
-            it = underConstruction.erase(it);
+// Removes the facilities completed by tick now from underConstruction in one pass: the ones
+// still being built move up in place, in start order, and the scores of the completed ones
+// are added to the plan together
+void Plan::completeConstructions(const FacilityCatalog &facilityOptions, Tick now) {
+    auto isDone = [now](const Construction &construction) {
+        return construction.doneTick <= now;
+    };
+    auto done = std::find_if(underConstruction.begin(), underConstruction.end(), isDone);
+    if (done == underConstruction.end()) {
+        return;
+    }
+    INSTRUMENT_HOT_SCOPE("Plan::step completion");
+    int lifeQualityGain = 0, economyGain = 0, environmentGain = 0;
+    auto kept = done;
+    for (auto it = done; it != underConstruction.end(); ++it) {
+        if (isDone(*it)) {
+            const FacilityType &type = facilityOptions.get(facilities[it->slot]);
+            lifeQualityGain += type.getLifeQualityScore();
+            economyGain += type.getEnvironmentScore();
+            environmentGain += type.getEconomyScore();
         } else {
-            ++it;
+            *kept++ = *it;
         }
     }
+    underConstruction.erase(kept, underConstruction.end());
+    life_quality_score += lifeQualityGain;
+    economy_score += economyGain;
+    environment_score += environmentGain;
+}
 
-    // Step 4: Update plan status
-    status = (underConstruction.size() == limit) ? PlanStatus::BUSY : PlanStatus::AVAILABLE;
+// Number of steps after tick now in which this plan can't start or finish anything, so
+// stepping it through them would change nothing. NO_EVENT if it is idle for good.
+int Plan::stepsUntilEvent(const FacilityCatalog &facilityOptions, Tick now) const {
+    if (status == PlanStatus::AVAILABLE && underConstruction.size() < static_cast<size_t>(constructionLimit()) &&
+        failedSelectionOptions != facilityOptions.size()) {
+        return 0;
+    }
+    Tick steps = NO_EVENT;
+    for (const Construction &construction : underConstruction) {
+        steps = std::min(steps, std::max(construction.doneTick - now - 1, static_cast<Tick>(0)));
+    }
+    return static_cast<int>(steps);
 }
 
-void Plan::addFacility(Facility *facility) {
-    if (facility->getStatus() == FacilityStatus::UNDER_CONSTRUCTIONS) {
-        underConstruction.push_back(facility);
-    } else if (facility->getStatus() == FacilityStatus::OPERATIONAL) {
-        facilities.push_back(facility);
+// Operational unless it is still under construction
+Facility Plan::buildFacility(size_t slot, const FacilityCatalog &facilityOptions, Tick now) const {
+    Facility facility(facilityOptions.get(facilities[slot]), settlement->getName());
+    for (const Construction &construction : underConstruction) {
+        if (construction.slot == slot) {
+            facility.advance(static_cast<int>(facility.getTimeLeft() - (construction.doneTick - now)));
+            facility.setStatus(FacilityStatus::UNDER_CONSTRUCTIONS);
+            return facility;
+        }
     }
+    facility.advance(facility.getTimeLeft());
+    facility.setStatus(FacilityStatus::OPERATIONAL);
+    return facility;
+}
+
+vector<Facility> Plan::getFacilities(const FacilityCatalog &facilityOptions, Tick now) const {
+    vector<Facility> result;
+    auto building = underConstruction.begin();
+    for (size_t slot = 0; slot < facilities.size(); ++slot) {
+        if (building != underConstruction.end() && building->slot == slot) {
+            ++building;
+        } else {
+            result.push_back(buildFacility(slot, facilityOptions, now));
+        }
+    }
+    return result;
+}
+
+vector<Facility> Plan::getUnderConstruction(const FacilityCatalog &facilityOptions, Tick now) const {
+    vector<Facility> result;
+    for (const Construction &construction : underConstruction) {
+        result.push_back(buildFacility(construction.slot, facilityOptions, now));
+    }
+    return result;
+}
+
+size_t Plan::getFacilityCount() const {
+    return facilities.size() - underConstruction.size();
+}
+
+size_t Plan::getUnderConstructionCount() const {
+    return underConstruction.size();
+}
+
+// A facility still under construction ticks down from its current timeLeft on the next step
+void Plan::addFacility(const Facility &facility, const FacilityCatalog &facilityOptions, Tick now) {
+    FacilityId type = facilityOptions.find(facility.getName());
+    if (type == FacilityCatalog::NO_FACILITY) {
+        throw std::invalid_argument("Unknown facility type: " + facility.getName());
+    }
+    if (facility.getStatus() != FacilityStatus::OPERATIONAL) {
+        underConstruction.push_back(Construction{facilities.size(), now + std::max(facility.getTimeLeft(), 1)});
+    }
+    facilities.push_back(type);
 }
 
 const string Plan::toString() const {
@@ -88,11 +272,20 @@ const string Plan::toString() const {
            ", Status: " + ((status == PlanStatus::AVAILABLE) ? "AVAILABLE" : "BUSY");
 }
 
-void Plan::printStatus() {
-    std::cout << toString() << std::endl;
-    std::cout << "Life Quality Score: " << life_quality_score << std::endl;
-    std::cout << "Economy Score: " << economy_score << std::endl;
-    std::cout << "Environment Score: " << environment_score << std::endl;
+void Plan::printStatus() const {
+    OutputWriter &out = standardOutput();
+    if (out.getFormat() == OutputFormat::JSON) {
+        out << "{\"type\":\"planStatus\",\"planId\":" << plan_id << ",\"settlement\":";
+        out.writeJsonString(settlement->getName());
+        out << ",\"status\":\"" << ((status == PlanStatus::AVAILABLE) ? "AVAILABLE" : "BUSY")
+            << "\",\"lifeQualityScore\":" << life_quality_score << ",\"economyScore\":" << economy_score
+            << ",\"environmentScore\":" << environment_score << "}\n";
+        return;
+    }
+    out << toString() << '\n';
+    out << "Life Quality Score: " << life_quality_score << '\n';
+    out << "Economy Score: " << economy_score << '\n';
+    out << "Environment Score: " << environment_score << '\n';
 }
 
 
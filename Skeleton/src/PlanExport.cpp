@@ -0,0 +1,101 @@
+#include "PlanExport.h"
+#include <cstdint>
+#include <unordered_map>
+using std::unordered_map;
+
+static const char COLUMNS_MAGIC[8] = {'P', 'L', 'A', 'N', 'C', 'O', 'L', 'S'};
+static const uint32_t COLUMNS_VERSION = 1;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+static const char *statusName(PlanStatus status) {
+    return (status == PlanStatus::AVAILABLE) ? "AVAILABLE" : "BUSY";
+}
+
+// Quotes a field only if it holds a comma, a quote or a line break
+static void writeCsvField(OutputWriter &out, const string &field) {
+    if (field.find_first_of(",\"\r\n") == string::npos) {
+        out << field;
+        return;
+    }
+    out << '"';
+    for (char character : field) {
+        if (character == '"') {
+            out << '"';
+        }
+        out << character;
+    }
+    out << '"';
+}
+
+void writePlanCsv(OutputWriter &out, const vector<const Plan *> &plans) {
+    out << "planId,settlement,status,lifeQualityScore,economyScore,environmentScore,facilities,underConstruction\n";
+    for (const Plan *plan : plans) {
+        out << plan->getPlanID() << ',';
+        writeCsvField(out, plan->getSettlement().getName());
+        out << ',' << statusName(plan->getStatus()) << ',' << plan->getLifeQualityScore() << ','
+            << plan->getEconomyScore() << ',' << plan->getEnvironmentScore() << ','
+            << plan->getFacilityCount() << ',' << plan->getUnderConstructionCount() << '\n';
+    }
+}
+
+void writePlanJson(OutputWriter &out, const vector<const Plan *> &plans) {
+    for (const Plan *plan : plans) {
+        out << "{\"type\":\"planStatus\",\"planId\":" << plan->getPlanID() << ",\"settlement\":";
+        out.writeJsonString(plan->getSettlement().getName());
+        out << ",\"status\":\"" << statusName(plan->getStatus())
+            << "\",\"lifeQualityScore\":" << plan->getLifeQualityScore() << ",\"economyScore\":" << plan->getEconomyScore()
+            << ",\"environmentScore\":" << plan->getEnvironmentScore() << ",\"facilities\":" << plan->getFacilityCount()
+            << ",\"underConstruction\":" << plan->getUnderConstructionCount() << "}\n";
+    }
+}
+
+template <typename T>
+static void writeValue(OutputWriter &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// One column: Field(plan) of every plan, gathered so the column is written in one piece
+template <typename T, typename Field>
+static void writeColumn(OutputWriter &out, const vector<const Plan *> &plans, vector<T> &column, Field field) {
+    column.clear();
+    for (const Plan *plan : plans) {
+        column.push_back(static_cast<T>(field(*plan)));
+    }
+    out.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+}
+
+void writePlanColumns(OutputWriter &out, const vector<const Plan *> &plans) {
+    out.write(COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+    writeValue(out, COLUMNS_VERSION);
+    writeValue(out, BYTE_ORDER_MARK);
+    writeValue(out, static_cast<uint64_t>(plans.size()));
+
+    // Settlements are numbered in the order they first appear
+    vector<const Settlement *> settlements;
+    unordered_map<const Settlement *, int32_t> settlementIndices;
+    for (const Plan *plan : plans) {
+        if (settlementIndices.emplace(&plan->getSettlement(), static_cast<int32_t>(settlements.size())).second) {
+            settlements.push_back(&plan->getSettlement());
+        }
+    }
+
+    vector<int32_t> column;
+    column.reserve(plans.size());
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getPlanID(); });
+    writeColumn(out, plans, column, [&](const Plan &plan) { return settlementIndices.at(&plan.getSettlement()); });
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getLifeQualityScore(); });
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getEconomyScore(); });
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getEnvironmentScore(); });
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getFacilityCount(); });
+    writeColumn(out, plans, column, [](const Plan &plan) { return plan.getUnderConstructionCount(); });
+    vector<uint8_t> statusColumn;
+    statusColumn.reserve(plans.size());
+    writeColumn(out, plans, statusColumn, [](const Plan &plan) { return plan.getStatus() == PlanStatus::BUSY; });
+
+    writeValue(out, static_cast<uint64_t>(settlements.size()));
+    for (const Settlement *settlement : settlements) {
+        const string &name = settlement->getName();
+        writeValue(out, static_cast<uint32_t>(name.size()));
+        out << name;
+    }
+}
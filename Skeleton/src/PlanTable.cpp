@@ -0,0 +1,44 @@
+#include "PlanTable.h"
+
+const size_t PlanTable::CHUNK_SIZE;
+
+PlanTable::PlanTable() : chunks(), slots(), planCount(0) {}
+
+size_t PlanTable::size() const {
+    return planCount;
+}
+
+const Plan &PlanTable::get(size_t index) const {
+    return *(*chunks[index / CHUNK_SIZE])[index % CHUNK_SIZE];
+}
+
+Plan &PlanTable::write(size_t index) {
+    return chunks[index / CHUNK_SIZE].write()[index % CHUNK_SIZE].write();
+}
+
+size_t PlanTable::indexOf(int planId) const {
+    if (planId < 0 || static_cast<size_t>(planId) >= slots->size() || (*slots)[planId] < 0) {
+        return std::string::npos;
+    }
+    return static_cast<size_t>((*slots)[planId]);
+}
+
+void PlanTable::add(const shared_ptr<Plan> &plan) {
+    size_t planId = static_cast<size_t>(plan->getPlanID());
+    vector<int> &slotList = slots.write();
+    if (slotList.size() <= planId) {
+        slotList.resize(planId + 1, -1);
+    }
+    slotList[planId] = static_cast<int>(planCount);
+    if (planCount % CHUNK_SIZE == 0) {
+        chunks.emplace_back();
+        chunks.back().write().reserve(CHUNK_SIZE);
+    }
+    chunks.back().write().emplace_back(plan);
+    ++planCount;
+}
+
+void PlanTable::reserve(size_t count) {
+    chunks.reserve((count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    slots.write().reserve(count);
+}
@@ -0,0 +1,246 @@
+#include "ScoringKernel.h"
+#include <atomic>
+#include <climits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORING_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+typedef size_t (*BalanceKernel)(const int *, const int *, size_t, int, int, int, int &);
+
+static inline int balanceDifference(int lifeQuality, int economy, int environment) {
+    int highest = lifeQuality > economy ? lifeQuality : economy;
+    int lowest = lifeQuality < economy ? lifeQuality : economy;
+    highest = environment > highest ? environment : highest;
+    lowest = environment < lowest ? environment : lowest;
+    return highest - lowest;
+}
+
+// Scans [begin, count) and only replaces best on a strictly smaller difference,
+// so the first minimum wins. Also finishes the tail left over by the vector kernels.
+static size_t scanScalar(const int *economyScores, const int *environmentScores, size_t begin, size_t count,
+                         int lifeQuality, int economy, int environment, size_t best, int &bestDifference) {
+    for (size_t i = begin; i < count; ++i) {
+        int difference = balanceDifference(lifeQuality, economy + economyScores[i], environment + environmentScores[i]);
+        if (best == count || difference < bestDifference) {
+            best = i;
+            bestDifference = difference;
+        }
+    }
+    return best;
+}
+
+static size_t findMostBalancedScalar(const int *economyScores, const int *environmentScores,
+                                     size_t count, int lifeQuality, int economy, int environment, int &bestDifference) {
+    return scanScalar(economyScores, environmentScores, 0, count, lifeQuality, economy, environment, count,
+                      bestDifference);
+}
+
+// Every lane keeps the first minimum it has seen, so across lanes the smallest index
+// among the smallest differences is the overall first minimum.
+static size_t reduceLanes(const int *laneDifferences, const int *laneIndices, int lanes, size_t count, int &bestDifference) {
+    size_t best = count;
+    for (int lane = 0; lane < lanes; ++lane) {
+        size_t index = static_cast<size_t>(laneIndices[lane]);
+        if (best == count || laneDifferences[lane] < bestDifference ||
+            (laneDifferences[lane] == bestDifference && index < best)) {
+            best = index;
+            bestDifference = laneDifferences[lane];
+        }
+    }
+    return best;
+}
+
+#ifdef SCORING_KERNEL_X86
+__attribute__((target("sse4.1")))
+static size_t findMostBalancedSse41(const int *economyScores, const int *environmentScores,
+                                    size_t count, int lifeQuality, int economy, int environment, int &bestDifference) {
+    if (count < 4) {
+        return findMostBalancedScalar(economyScores, environmentScores, count, lifeQuality, economy, environment,
+                                      bestDifference);
+    }
+    const __m128i life = _mm_set1_epi32(lifeQuality);
+    const __m128i baseEconomy = _mm_set1_epi32(economy);
+    const __m128i baseEnvironment = _mm_set1_epi32(environment);
+    const __m128i laneStep = _mm_set1_epi32(4);
+    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i minDifferences = _mm_set1_epi32(INT_MAX);
+    __m128i minIndices = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i eco = _mm_add_epi32(baseEconomy, _mm_loadu_si128(reinterpret_cast<const __m128i *>(economyScores + i)));
+        __m128i env = _mm_add_epi32(baseEnvironment, _mm_loadu_si128(reinterpret_cast<const __m128i *>(environmentScores + i)));
+        __m128i differences = _mm_sub_epi32(_mm_max_epi32(_mm_max_epi32(life, eco), env),
+                                            _mm_min_epi32(_mm_min_epi32(life, eco), env));
+        __m128i smaller = _mm_cmpgt_epi32(minDifferences, differences);
+        minDifferences = _mm_blendv_epi8(minDifferences, differences, smaller);
+        minIndices = _mm_blendv_epi8(minIndices, indices, smaller);
+        indices = _mm_add_epi32(indices, laneStep);
+    }
+
+    int laneDifferences[4], laneIndices[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(laneDifferences), minDifferences);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(laneIndices), minIndices);
+    size_t best = reduceLanes(laneDifferences, laneIndices, 4, count, bestDifference);
+    return scanScalar(economyScores, environmentScores, i, count, lifeQuality, economy, environment, best,
+                      bestDifference);
+}
+
+__attribute__((target("avx2")))
+static size_t findMostBalancedAvx2(const int *economyScores, const int *environmentScores,
+                                   size_t count, int lifeQuality, int economy, int environment, int &bestDifference) {
+    if (count < 8) {
+        return findMostBalancedScalar(economyScores, environmentScores, count, lifeQuality, economy, environment,
+                                      bestDifference);
+    }
+    const __m256i life = _mm256_set1_epi32(lifeQuality);
+    const __m256i baseEconomy = _mm256_set1_epi32(economy);
+    const __m256i baseEnvironment = _mm256_set1_epi32(environment);
+    const __m256i laneStep = _mm256_set1_epi32(8);
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i minDifferences = _mm256_set1_epi32(INT_MAX);
+    __m256i minIndices = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i eco = _mm256_add_epi32(baseEconomy, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(economyScores + i)));
+        __m256i env = _mm256_add_epi32(baseEnvironment, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(environmentScores + i)));
+        __m256i differences = _mm256_sub_epi32(_mm256_max_epi32(_mm256_max_epi32(life, eco), env),
+                                               _mm256_min_epi32(_mm256_min_epi32(life, eco), env));
+        __m256i smaller = _mm256_cmpgt_epi32(minDifferences, differences);
+        minDifferences = _mm256_blendv_epi8(minDifferences, differences, smaller);
+        minIndices = _mm256_blendv_epi8(minIndices, indices, smaller);
+        indices = _mm256_add_epi32(indices, laneStep);
+    }
+
+    int laneDifferences[8], laneIndices[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(laneDifferences), minDifferences);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(laneIndices), minIndices);
+    size_t best = reduceLanes(laneDifferences, laneIndices, 8, count, bestDifference);
+    return scanScalar(economyScores, environmentScores, i, count, lifeQuality, economy, environment, best,
+                      bestDifference);
+}
+
+// GCC 12 warns about the undefined pass-through vectors inside the AVX-512 min/max intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static size_t findMostBalancedAvx512(const int *economyScores, const int *environmentScores,
+                                     size_t count, int lifeQuality, int economy, int environment, int &bestDifference) {
+    if (count < 16) {
+        return findMostBalancedScalar(economyScores, environmentScores, count, lifeQuality, economy, environment,
+                                      bestDifference);
+    }
+    const __m512i life = _mm512_set1_epi32(lifeQuality);
+    const __m512i baseEconomy = _mm512_set1_epi32(economy);
+    const __m512i baseEnvironment = _mm512_set1_epi32(environment);
+    const __m512i laneStep = _mm512_set1_epi32(16);
+    __m512i indices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i minDifferences = _mm512_set1_epi32(INT_MAX);
+    __m512i minIndices = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i eco = _mm512_add_epi32(baseEconomy, _mm512_loadu_si512(economyScores + i));
+        __m512i env = _mm512_add_epi32(baseEnvironment, _mm512_loadu_si512(environmentScores + i));
+        __m512i differences = _mm512_sub_epi32(_mm512_max_epi32(_mm512_max_epi32(life, eco), env),
+                                               _mm512_min_epi32(_mm512_min_epi32(life, eco), env));
+        __mmask16 smaller = _mm512_cmplt_epi32_mask(differences, minDifferences);
+        minDifferences = _mm512_mask_mov_epi32(minDifferences, smaller, differences);
+        minIndices = _mm512_mask_mov_epi32(minIndices, smaller, indices);
+        indices = _mm512_add_epi32(indices, laneStep);
+    }
+
+    int laneDifferences[16], laneIndices[16];
+    _mm512_storeu_si512(laneDifferences, minDifferences);
+    _mm512_storeu_si512(laneIndices, minIndices);
+    size_t best = reduceLanes(laneDifferences, laneIndices, 16, count, bestDifference);
+    return scanScalar(economyScores, environmentScores, i, count, lifeQuality, economy, environment, best,
+                      bestDifference);
+}
+#pragma GCC diagnostic pop
+#endif
+
+static bool isSupported(ScoringKernel kernel) {
+#ifdef SCORING_KERNEL_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+        case ScoringKernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+        case ScoringKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case ScoringKernel::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case ScoringKernel::SCALAR:
+            return true;
+    }
+    return false;
+#else
+    return kernel == ScoringKernel::SCALAR;
+#endif
+}
+
+static ScoringKernel detectKernel() {
+    const ScoringKernel preferred[] = {ScoringKernel::AVX512, ScoringKernel::AVX2, ScoringKernel::SSE41};
+    for (ScoringKernel kernel : preferred) {
+        if (isSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return ScoringKernel::SCALAR;
+}
+
+static BalanceKernel balanceKernel(ScoringKernel kernel) {
+#ifdef SCORING_KERNEL_X86
+    switch (kernel) {
+        case ScoringKernel::AVX512:
+            return findMostBalancedAvx512;
+        case ScoringKernel::AVX2:
+            return findMostBalancedAvx2;
+        case ScoringKernel::SSE41:
+            return findMostBalancedSse41;
+        case ScoringKernel::SCALAR:
+            break;
+    }
+#endif
+    return findMostBalancedScalar;
+}
+
+static std::atomic<int> &activeKernel() {
+    static std::atomic<int> kernel(static_cast<int>(detectKernel()));
+    return kernel;
+}
+
+size_t findMostBalanced(const int *economyScores, const int *environmentScores, size_t count,
+                        int lifeQuality, int economy, int environment, int &bestDifference) {
+    return balanceKernel(getScoringKernel())(economyScores, environmentScores, count, lifeQuality, economy, environment,
+                                             bestDifference);
+}
+
+ScoringKernel getScoringKernel() {
+    return static_cast<ScoringKernel>(activeKernel().load(std::memory_order_relaxed));
+}
+
+bool setScoringKernel(ScoringKernel kernel) {
+    if (!isSupported(kernel)) {
+        return false;
+    }
+    activeKernel().store(static_cast<int>(kernel), std::memory_order_relaxed);
+    return true;
+}
+
+const char *scoringKernelName(ScoringKernel kernel) {
+    switch (kernel) {
+        case ScoringKernel::AVX512:
+            return "avx512";
+        case ScoringKernel::AVX2:
+            return "avx2";
+        case ScoringKernel::SSE41:
+            return "sse4.1";
+        case ScoringKernel::SCALAR:
+            break;
+    }
+    return "scalar";
+}
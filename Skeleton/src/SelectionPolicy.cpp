@@ -1,17 +1,75 @@
 #include "SelectionPolicy.h"
-#include <algorithm> // for std::min_element and std::max_element
+#include "Instrumentation.h"
+#include "ScoringKernel.h"
+#include "Snapshot.h"
 #include <stdexcept> // for std::logic_error
 #include <sstream>   // for std::ostringstream
 
+// Snapshot tags of the policies
+enum PolicyTag { NAIVE_POLICY, BALANCED_POLICY, ECONOMY_POLICY, SUSTAINABILITY_POLICY };
+
+static int readLastSelectedIndex(SnapshotReader& reader) {
+    int lastSelectedIndex = reader.readInt();
+    if (lastSelectedIndex < -1) {
+        throw std::runtime_error("Invalid selection policy state in snapshot");
+    }
+    return lastSelectedIndex;
+}
+
+// The balanced policy's cache is not saved; it is rebuilt on the first selection
+SelectionPolicy* SelectionPolicy::load(SnapshotReader& reader) {
+    switch (reader.readByte()) {
+        case NAIVE_POLICY:
+            return new NaiveSelection(readLastSelectedIndex(reader));
+        case BALANCED_POLICY: {
+            int lifeQualityScore = reader.readInt();
+            int economyScore = reader.readInt();
+            int environmentScore = reader.readInt();
+            return new BalancedSelection(lifeQualityScore, economyScore, environmentScore);
+        }
+        case ECONOMY_POLICY:
+            return new EconomySelection(readLastSelectedIndex(reader));
+        case SUSTAINABILITY_POLICY:
+            return new SustainabilitySelection(readLastSelectedIndex(reader));
+        default:
+            throw std::runtime_error("Unknown selection policy in snapshot");
+    }
+}
+
+int selectRoundRobin(const vector<FacilityId>& candidates, int &lastSelectedIndex, int count, FacilityId *out) {
+    if (candidates.empty()) {
+        return 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        lastSelectedIndex = (lastSelectedIndex + 1) % candidates.size(); // Round-robin selection
+        out[i] = candidates[lastSelectedIndex];
+    }
+    return count;
+}
+
 // NaiveSelection Implementation
 NaiveSelection::NaiveSelection() : lastSelectedIndex(-1) {}
 
-const FacilityType& NaiveSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
-    if (facilitiesOptions.empty()) {
+NaiveSelection::NaiveSelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
+FacilityId NaiveSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    FacilityId selected;
+    if (selectFacilities(facilitiesOptions, 1, &selected) == 0) {
         throw std::logic_error("No facilities available for selection.");
     }
-    lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size(); // Round-robin selection
-    return facilitiesOptions[lastSelectedIndex];
+    return selected;
+}
+
+int NaiveSelection::selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) {
+    INSTRUMENT_HOT_SCOPE("NaiveSelection::selectFacilities");
+    if (facilitiesOptions.empty()) {
+        return 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size(); // Round-robin selection
+        out[i] = lastSelectedIndex;
+    }
+    return count;
 }
 
 const string NaiveSelection::toString() const {
@@ -22,30 +80,63 @@ NaiveSelection* NaiveSelection::clone() const {
     return new NaiveSelection(*this); // Copy the object
 }
 
+void NaiveSelection::save(SnapshotWriter& writer) const {
+    writer.writeByte(NAIVE_POLICY);
+    writer.writeInt(lastSelectedIndex);
+}
+
 // BalancedSelection Implementation
 BalancedSelection::BalancedSelection(int lifeQualityScore, int economyScore, int environmentScore)
-    : LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore) {}
+    : LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore),
+      indexedCatalog(nullptr), scannedGroups(0), bestFacility(FacilityCatalog::NO_FACILITY), bestDifference(0) {}
 
-const FacilityType& BalancedSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
-    if (facilitiesOptions.empty()) {
+FacilityId BalancedSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    FacilityId selected;
+    if (selectFacilities(facilitiesOptions, 1, &selected) == 0) {
         throw std::logic_error("No facilities available for selection.");
     }
+    return selected;
+}
 
-    // Lambda to calculate balance difference
-    auto balanceDifference = [this](const FacilityType& facility) {
-        int updatedScores[] = {
-            LifeQualityScore + facility.getLifeQualityScore(),
-            EconomyScore + facility.getEconomyScore(),
-            EnvironmentScore + facility.getEnvironmentScore()
-        };
-        return *std::max_element(updatedScores, updatedScores + 3) - *std::min_element(updatedScores, updatedScores + 3);
-    };
+// This policy's scores never change, so every selection from the same options is the same facility
+int BalancedSelection::selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) {
+    INSTRUMENT_HOT_SCOPE("BalancedSelection::selectFacilities");
+    if (facilitiesOptions.empty()) {
+        return 0;
+    }
+    updateBestFacility(facilitiesOptions);
+    for (int i = 0; i < count; ++i) {
+        out[i] = bestFacility;
+    }
+    return count;
+}
+
+// The balance difference only depends on a facility's score offsets, so it is enough to
+// look at one facility per balance group. This policy's scores never change, so the best
+// group found so far stays best and only groups added since the last call are checked.
+void BalancedSelection::updateBestFacility(const FacilityCatalog& facilitiesOptions) {
+    const BalanceGroups &groups = facilitiesOptions.getBalanceGroups();
+    size_t groupCount = groups.firstIds.size();
+    if (indexedCatalog != &facilitiesOptions || scannedGroups > groupCount) {
+        indexedCatalog = &facilitiesOptions;
+        scannedGroups = 0;
+        bestFacility = FacilityCatalog::NO_FACILITY;
+    }
 
-    // Select facility with the smallest balance difference
-    return *std::min_element(facilitiesOptions.begin(), facilitiesOptions.end(),
-                             [&](const FacilityType& a, const FacilityType& b) {
-                                 return balanceDifference(a) < balanceDifference(b);
-                             });
+    // Groups are ordered by their first id, so keeping the first minimum matches
+    // std::min_element over all facilities
+    if (scannedGroups < groupCount) {
+        int difference = 0;
+        size_t newGroups = groupCount - scannedGroups;
+        size_t best = findMostBalanced(groups.economyOffsets.data() + scannedGroups,
+                                       groups.environmentOffsets.data() + scannedGroups, newGroups,
+                                       LifeQualityScore, EconomyScore, EnvironmentScore, difference);
+        if (bestFacility == FacilityCatalog::NO_FACILITY || difference < bestDifference) {
+            bestFacility = groups.firstIds[scannedGroups + best];
+            bestDifference = difference;
+        }
+        scannedGroups = groupCount;
+    }
 }
 
 const string BalancedSelection::toString() const {
@@ -61,28 +152,32 @@ BalancedSelection* BalancedSelection::clone() const {
     return new BalancedSelection(*this); // Copy the object
 }
 
+void BalancedSelection::save(SnapshotWriter& writer) const {
+    writer.writeByte(BALANCED_POLICY);
+    writer.writeInt(LifeQualityScore);
+    writer.writeInt(EconomyScore);
+    writer.writeInt(EnvironmentScore);
+}
+
 // EconomySelection Implementation
 EconomySelection::EconomySelection() : lastSelectedIndex(-1) {}
 
-const FacilityType& EconomySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+EconomySelection::EconomySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
+FacilityId EconomySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     if (facilitiesOptions.empty()) {
         throw std::logic_error("No facilities available for selection.");
     }
-
-    // Filter economy facilities
-    vector<const FacilityType*> economyFacilities;
-    for (const auto& facility : facilitiesOptions) {
-        if (facility.getCategory() == FacilityCategory::ECONOMY) {
-            economyFacilities.push_back(&facility);
-        }
-    }
-
-    if (economyFacilities.empty()) {
+    FacilityId selected;
+    if (selectFacilities(facilitiesOptions, 1, &selected) == 0) {
         throw std::logic_error("No facilities in the ECONOMY category are available.");
     }
+    return selected;
+}
 
-    lastSelectedIndex = (lastSelectedIndex + 1) % economyFacilities.size(); // Round-robin selection
-    return *economyFacilities[lastSelectedIndex];
+int EconomySelection::selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) {
+    INSTRUMENT_HOT_SCOPE("EconomySelection::selectFacilities");
+    return selectRoundRobin(facilitiesOptions.getCategory(FacilityCategory::ECONOMY), lastSelectedIndex, count, out);
 }
 
 const string EconomySelection::toString() const {
@@ -93,28 +188,30 @@ EconomySelection* EconomySelection::clone() const {
     return new EconomySelection(*this); // Copy the object
 }
 
+void EconomySelection::save(SnapshotWriter& writer) const {
+    writer.writeByte(ECONOMY_POLICY);
+    writer.writeInt(lastSelectedIndex);
+}
+
 // SustainabilitySelection Implementation
 SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(-1) {}
 
-const FacilityType& SustainabilitySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+SustainabilitySelection::SustainabilitySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
+FacilityId SustainabilitySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     if (facilitiesOptions.empty()) {
         throw std::logic_error("No facilities available for selection.");
     }
-
-    // Filter environment facilities
-    vector<const FacilityType*> environmentFacilities;
-    for (const auto& facility : facilitiesOptions) {
-        if (facility.getCategory() == FacilityCategory::ENVIRONMENT) {
-            environmentFacilities.push_back(&facility);
-        }
-    }
-
-    if (environmentFacilities.empty()) {
+    FacilityId selected;
+    if (selectFacilities(facilitiesOptions, 1, &selected) == 0) {
         throw std::logic_error("No facilities in the ENVIRONMENT category are available.");
     }
+    return selected;
+}
 
-    lastSelectedIndex = (lastSelectedIndex + 1) % environmentFacilities.size(); // Round-robin selection
-    return *environmentFacilities[lastSelectedIndex];
+int SustainabilitySelection::selectFacilities(const FacilityCatalog& facilitiesOptions, int count, FacilityId *out) {
+    INSTRUMENT_HOT_SCOPE("SustainabilitySelection::selectFacilities");
+    return selectRoundRobin(facilitiesOptions.getCategory(FacilityCategory::ENVIRONMENT), lastSelectedIndex, count, out);
 }
 
 const string SustainabilitySelection::toString() const {
@@ -124,3 +221,8 @@ const string SustainabilitySelection::toString() const {
 SustainabilitySelection* SustainabilitySelection::clone() const {
     return new SustainabilitySelection(*this); // Copy the object
 }
+
+void SustainabilitySelection::save(SnapshotWriter& writer) const {
+    writer.writeByte(SUSTAINABILITY_POLICY);
+    writer.writeInt(lastSelectedIndex);
+}
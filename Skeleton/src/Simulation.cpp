@@ -1,147 +1,1117 @@
 #include "Simulation.h"
 #include "SelectionPolicy.h"
 #include "Action.h"
-#include <fstream>
+#include "ConfigFile.h"
+#include "Instrumentation.h"
+#include "OutputWriter.h"
+#include "Snapshot.h"
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <unistd.h>
+#include <utility>
 
 using std::logic_error;
 using std::runtime_error;
 using std::find_if;
 using std::cin;
 using std::istringstream;
-using std::ifstream;
 using std::getline;
+using std::lock_guard;
+using std::unique_lock;
+using std::unique_ptr;
+
+extern Simulation *backup;
+
+// A single action at a time lives in the command arena
+static const size_t COMMAND_ARENA_BLOCK_SIZE = 1024;
+
+// Config files smaller than this load faster on one thread than they take to split
+static const size_t PARALLEL_CONFIG_MIN_SIZE = 512 * 1024;
+
+// Bytes per unit of parallel config parsing; every block is parsed into its own staging buffer
+static const size_t CONFIG_BLOCK_SIZE = 4096;
+
+// Plans per shard of the schedule. Whole table chunks, as plans in one chunk can't be written
+// from two threads.
+static const size_t SCHEDULE_SHARD_SIZE = 16 * PlanTable::CHUNK_SIZE;
+
+// One parsed line of the configuration file, applied to the simulation by applyConfigLine
+struct StagedConfigLine {
+    enum Kind { STEP, THREADS, PIPELINE, OUTPUT, LOG_LIMIT, PLAN, SETTLEMENT, FACILITY, FAILED };
+
+    StagedConfigLine(const TokenView &line) : kind(FAILED), line(line), name(), policyType(), values() {}
+
+    Kind kind;
+    TokenView line;
+    string name; //Settlement, plan settlement or facility name, OUTPUT format; the error message if FAILED
+    string policyType;
+    int values[5]; //STEP/THREADS count, PIPELINE flag, LOG_LIMIT, SETTLEMENT type, FACILITY category, price and impacts
+};
 
 // Constructor
-Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0), actionsLog(), plans(), settlements(), facilitiesOptions() {
-    ifstream configFile(configFilePath);
-    if (!configFile.is_open()) {
-        throw runtime_error("Failed to open configuration file: " + configFilePath);
+Simulation::Simulation(const string &configFilePath, int threadCount) : isRunning(false), planCounter(0), currentTick(0), actionsLog(), plans(), settlements(), facilitiesOptions(), stepPool(threadCount), schedule(), commandArena(COMMAND_ARENA_BLOCK_SIZE), checkpoints(), pipelined(false) {
+    INSTRUMENT_SCOPE("Simulation config load");
+    ConfigFile configFile(configFilePath);
+    if (stepPool.getThreadCount() == 1 || configFile.getSize() < PARALLEL_CONFIG_MIN_SIZE || !loadConfigParallel(configFile)) {
+        loadConfigSerial(configFile);
     }
+}
 
-    string line;
-    while (getline(configFile, line)) {
-        istringstream stream(line);
-        string command;
-        stream >> command;
+// Errors go to std::cerr; standard output is flushed first so the two stay in order
+static void printConfigError(const TokenView &line, const char *error) {
+    standardOutput().flush();
+    std::cerr << "Error processing configuration command: ";
+    std::cerr.write(line.data, line.length);
+    std::cerr << "\n" << error << "\n";
+}
 
-        if (line.empty() || line[0] == '#') {
+static const TokenView &configArgument(const TokenView *tokens, size_t tokenCount, size_t index) {
+    if (index >= tokenCount) {
+        throw runtime_error("Missing arguments");
+    }
+    return tokens[index];
+}
+
+static int configIntArgument(const TokenView *tokens, size_t tokenCount, size_t index) {
+    const TokenView &token = configArgument(tokens, tokenCount, index);
+    int value;
+    if (!parseInt(token, value)) {
+        throw runtime_error("Invalid number: " + token.str());
+    }
+    return value;
+}
+
+// Parses one tokenized line of the configuration file without touching the simulation
+static void parseConfigLine(const TokenView *tokens, size_t tokenCount, StagedConfigLine &staged) {
+    if (tokenCount == 0) {
+        throw runtime_error("Unknown command in configuration file: ");
+    }
+    const TokenView &command = tokens[0];
+    if (command.equals("step") || command.equals("threads")) {
+        staged.values[0] = configIntArgument(tokens, tokenCount, 1);
+        staged.kind = command.equals("step") ? StagedConfigLine::STEP : StagedConfigLine::THREADS;
+    } else if (command.equals("pipeline")) {
+        staged.values[0] = configIntArgument(tokens, tokenCount, 1);
+        staged.kind = StagedConfigLine::PIPELINE;
+    } else if (command.equals("output")) {
+        const TokenView &format = configArgument(tokens, tokenCount, 1);
+        if (!format.equals("text") && !format.equals("json")) {
+            throw runtime_error("Unknown output format: " + format.str());
+        }
+        staged.name = format.str();
+        staged.kind = StagedConfigLine::OUTPUT;
+    } else if (command.equals("logLimit")) {
+        staged.values[0] = configIntArgument(tokens, tokenCount, 1);
+        if (staged.values[0] < 0) {
+            throw runtime_error("Invalid log limit: " + tokens[1].str());
+        }
+        staged.kind = StagedConfigLine::LOG_LIMIT;
+    } else if (command.equals("plan")) {
+        staged.name = configArgument(tokens, tokenCount, 1).str();
+        staged.policyType = configArgument(tokens, tokenCount, 2).str();
+        staged.kind = StagedConfigLine::PLAN;
+    } else if (command.equals("settlement")) {
+        staged.name = configArgument(tokens, tokenCount, 1).str();
+        staged.values[0] = configIntArgument(tokens, tokenCount, 2);
+        staged.kind = StagedConfigLine::SETTLEMENT;
+    } else if (command.equals("facility")) {
+        const TokenView &category = configArgument(tokens, tokenCount, 2);
+        for (size_t i = 1; i < 5; ++i) {
+            staged.values[i] = configIntArgument(tokens, tokenCount, i + 2);
+        }
+        if (!parseInt(category, staged.values[0]) || staged.values[0] < 0 || staged.values[0] > 2) {
+            throw runtime_error("Unknown facility category: " + category.str());
+        }
+        staged.name = configArgument(tokens, tokenCount, 1).str();
+        staged.kind = StagedConfigLine::FACILITY;
+    } else {
+        throw runtime_error("Unknown command in configuration file: " + command.str());
+    }
+}
+
+// Applies one parsed line, in file order
+void Simulation::applyConfigLine(const StagedConfigLine &staged) {
+    switch (staged.kind) {
+        case StagedConfigLine::STEP:
+            step(staged.values[0]);
+            break;
+        case StagedConfigLine::THREADS:
+            setThreadCount(staged.values[0]);
+            break;
+        case StagedConfigLine::PIPELINE:
+            setPipelined(staged.values[0] != 0);
+            break;
+        case StagedConfigLine::OUTPUT:
+            standardOutput().setFormat(staged.name == "json" ? OutputFormat::JSON : OutputFormat::TEXT);
+            break;
+        case StagedConfigLine::LOG_LIMIT:
+            setActionsLogLimit(static_cast<size_t>(staged.values[0]));
+            break;
+        case StagedConfigLine::PLAN: {
+            const Settlement *settlement = getSettlement(staged.name);
+            if (!settlement) {
+                throw runtime_error("Settlement not found: " + staged.name);
+            }
+            addPlan(settlement, createPolicy(staged.policyType));
+            break;
+        }
+        case StagedConfigLine::SETTLEMENT: {
+            auto settlement = new Settlement(staged.name, static_cast<SettlementType>(staged.values[0]));
+            if (!addSettlement(settlement)) {
+                delete settlement; // Prevent memory leak
+            }
+            break;
+        }
+        case StagedConfigLine::FACILITY: {
+            FacilityType facility(staged.name, static_cast<FacilityCategory>(staged.values[0]), staged.values[1], staged.values[2], staged.values[3], staged.values[4]);
+            if (!addFacility(facility)) {
+                standardOutput().flush();
+                std::cerr << "Facility \"" << facility.getName() << "\" already exists.\n";
+            }
+            break;
+        }
+        case StagedConfigLine::FAILED:
+            throw runtime_error(staged.name);
+    }
+}
+
+void Simulation::loadConfigSerial(ConfigFile &configFile) {
+    TokenView line;
+    TokenView tokens[ConfigFile::MAX_TOKENS];
+    while (configFile.nextLine(line)) {
+        if (line.length == 0 || line.data[0] == '#') {
             continue; // Skip comments and empty lines
         }
 
+        StagedConfigLine staged(line);
         try {
-            if (command == "step") {
-                int numOfSteps;
-                stream >> numOfSteps;
-                for (int i = 0; i < numOfSteps; ++i) {
-                    step();
-                }
-            } else if (command == "plan") {
-                string settlementName, policyType;
-                stream >> settlementName >> policyType;
-                Settlement *settlement = getSettlement(settlementName);
-                if (!settlement) {
-                    throw runtime_error("Settlement not found: " + settlementName);
-                }
-                SelectionPolicy *policy = createPolicy(policyType);
-                if (!policy) {
-                    throw runtime_error("Unknown selection policy: " + policyType);
+            parseConfigLine(tokens, tokenize(line, tokens, ConfigFile::MAX_TOKENS), staged);
+            applyConfigLine(staged);
+        } catch (const std::exception &e) {
+            printConfigError(line, e.what());
+        }
+    }
+}
+
+// Parses newline-aligned blocks of the file on the step pool, then applies the staged lines
+// in file order, so duplicates and plans resolve exactly as in loadConfigSerial. A step line
+// depends on everything before it, so a file with one is left to loadConfigSerial (returns false).
+bool Simulation::loadConfigParallel(const ConfigFile &configFile) {
+    const char *data = configFile.getData();
+    size_t size = configFile.getSize();
+    size_t blockCount = (size + CONFIG_BLOCK_SIZE - 1) / CONFIG_BLOCK_SIZE;
+    vector<vector<StagedConfigLine>> blocks(blockCount);
+    std::atomic<bool> hasStep(false);
+
+    stepPool.parallelFor(blockCount, [&](size_t begin, size_t end) {
+        TokenView line;
+        TokenView tokens[ConfigFile::MAX_TOKENS];
+        for (size_t block = begin; block < end && !hasStep; ++block) {
+            size_t position = alignToLine(data, size, block * CONFIG_BLOCK_SIZE);
+            size_t blockEnd = alignToLine(data, size, (block + 1) * CONFIG_BLOCK_SIZE);
+            vector<StagedConfigLine> &staged = blocks[block];
+            while (nextLine(data, blockEnd, position, line)) {
+                if (line.length == 0 || line.data[0] == '#') {
+                    continue;
                 }
-                addPlan(settlement, policy);
-            } else if (command == "Settlement") {
-                string settlementName;
-                int settlementType;
-                stream >> settlementName >> settlementType;
-                auto settlement = new Settlement(settlementName, static_cast<SettlementType>(settlementType));
-                if (!addSettlement(settlement)) {
-                    delete settlement; // Prevent memory leak
+                staged.emplace_back(line);
+                try {
+                    parseConfigLine(tokens, tokenize(line, tokens, ConfigFile::MAX_TOKENS), staged.back());
+                } catch (const std::exception &e) {
+                    staged.back().name = e.what();
                 }
-            } else if (command == "Facility") {
-                string facilityName, category;
-                int price, lifeQImpact, ecoImpact, envImpact;
-                stream >> facilityName >> category >> price >> lifeQImpact >> ecoImpact >> envImpact;
-
-                FacilityCategory facilityCategory = parseFacilityCategory(category);
-                FacilityType facility(facilityName, facilityCategory, price, lifeQImpact, ecoImpact, envImpact);
-                if (!addFacility(facility)) {
-                    std::cerr << "Facility \"" << facilityName << "\" already exists.\n";
+                if (staged.back().kind == StagedConfigLine::STEP) {
+                    hasStep = true;
+                    return;
                 }
-            } else {
-                throw runtime_error("Unknown command in configuration file: " + command);
             }
-        } catch (const std::exception &e) {
-            std::cerr << "Error processing configuration command: " << line << "\n"
-                      << e.what() << "\n";
         }
+    });
+    if (hasStep) {
+        return false;
+    }
+
+    size_t settlementCount = 0, planCount = 0;
+    for (const vector<StagedConfigLine> &block : blocks) {
+        for (const StagedConfigLine &staged : block) {
+            settlementCount += staged.kind == StagedConfigLine::SETTLEMENT;
+            planCount += staged.kind == StagedConfigLine::PLAN;
+        }
+    }
+    SettlementTable &settlementTable = settlements.write();
+    settlementTable.ordered.reserve(settlementTable.ordered.size() + settlementCount);
+    settlementTable.byName.reserve(settlementTable.byName.size() + settlementCount);
+    PlanTable &planTable = plans.write();
+    planTable.reserve(planTable.size() + planCount);
+
+    for (const vector<StagedConfigLine> &block : blocks) {
+        for (const StagedConfigLine &staged : block) {
+            try {
+                applyConfigLine(staged);
+            } catch (const std::exception &e) {
+                printConfigError(staged.line, e.what());
+            }
+        }
+    }
+    return true;
+}
+
+// Registers a facility type; returns false if one with the same name already exists
+bool Simulation::addFacility(const FacilityType &facility) {
+    if (facilitiesOptions->contains(facility.getName())) {
+        return false;
+    }
+    if (facilitiesOptions.write().add(facility) == FacilityCatalog::NO_FACILITY) {
+        return false;
+    }
+    schedule.clear(); //Plans that had nothing left to select may have now
+    return true;
+}
+
+FacilityCategory Simulation::parseFacilityCategory(const string &category) {
+    if (category == "0") {
+        return FacilityCategory::LIFE_QUALITY;
+    }
+    if (category == "1") {
+        return FacilityCategory::ECONOMY;
+    }
+    if (category == "2") {
+        return FacilityCategory::ENVIRONMENT;
     }
+    throw runtime_error("Unknown facility category: " + category);
 }
 
 // Starts the simulation
 void Simulation::start() {
     open();
+    if (pipelined) {
+        runCommandsPipelined();
+    } else {
+        runCommands();
+    }
+    standardOutput().flush();
+}
+
+// planStatus <all|first-last> [settlement <type>] [policy <type>] [csv|columns <path>]; the rest
+// of the line after target is left in stream
+static BaseAction *parsePlansStatus(const string &target, istringstream &stream, Arena &arena) {
+    Simulation::PlanQuery query;
+    if (target != "all") {
+        istringstream range(target);
+        char dash = 0;
+        if (!(range >> query.firstPlanId >> dash >> query.lastPlanId) || dash != '-' || !(range >> std::ws).eof()) {
+            throw runtime_error("Invalid plan range: " + target);
+        }
+    }
+    PlanExportFormat format = PlanExportFormat::CSV;
+    string path;
+    string option;
+    while (stream >> option) {
+        if (option == "settlement") {
+            if (!(stream >> query.settlementType) || query.settlementType < 0 || query.settlementType > 2) {
+                throw runtime_error("Invalid settlement type");
+            }
+        } else if (option == "policy") {
+            stream >> query.policyType;
+        } else if (option == "csv" || option == "columns") {
+            format = (option == "csv") ? PlanExportFormat::CSV : PlanExportFormat::COLUMNS;
+            if (!(stream >> path)) {
+                throw runtime_error("Missing file path");
+            }
+        } else {
+            throw runtime_error("Unknown planStatus option: " + option);
+        }
+    }
+    return arena.create<ExportPlansStatus>(query, format, path);
+}
+
+// Turns one command line into its action, created in arena. Reads nothing but line, so the
+// pipelined command loop can parse on its reader thread.
+BaseAction *Simulation::parseCommand(const string &line, Arena &arena) {
+    istringstream stream(line);
+    string command;
+    stream >> command;
+
+    BaseAction *action = nullptr;
+    if (command == "step") {
+        int numOfSteps;
+        stream >> numOfSteps;
+        action = arena.create<SimulateStep>(numOfSteps);
+    } else if (command == "plan") {
+        string settlementName, policyType;
+        stream >> settlementName >> policyType;
+        action = arena.create<AddPlan>(settlementName, policyType);
+    } else if (command == "planStatus") {
+        string target;
+        stream >> target;
+        if (target == "all" || target.find('-', 1) != string::npos) {
+            return parsePlansStatus(target, stream, arena);
+        }
+        int planId;
+        istringstream(target) >> planId;
+        action = arena.create<PrintPlanStatus>(planId);
+    } else if (command == "settlement") {
+        string settlementName;
+        int settlementType;
+        stream >> settlementName >> settlementType;
+        action = arena.create<AddSettlement>(settlementName, static_cast<SettlementType>(settlementType));
+    } else if (command == "facility") {
+        string facilityName, category;
+        int price, lifeQImpact, ecoImpact, envImpact;
+        stream >> facilityName >> category >> price >> lifeQImpact >> ecoImpact >> envImpact;
+        action = arena.create<AddFacility>(facilityName, parseFacilityCategory(category), price, lifeQImpact, ecoImpact, envImpact);
+    } else if (command == "actionsLog") {
+        action = arena.create<PrintActionsLog>();
+    } else if (command == "changePolicy") {
+        int planId;
+        string newPolicyType;
+        stream >> planId >> newPolicyType;
+        action = arena.create<ChangePlanPolicy>(planId, newPolicyType);
+    } else if (command == "comparePolicies") {
+        int planId, numOfSteps;
+        stream >> planId >> numOfSteps;
+        vector<string> policyTypes;
+        string policyType;
+        while (stream >> policyType) {
+            policyTypes.push_back(policyType);
+        }
+        if (policyTypes.empty()) {
+            policyTypes = {"nve", "bal", "eco", "env"};
+        }
+        action = arena.create<ComparePolicies>(planId, numOfSteps, policyTypes);
+    } else if (command == "backup") {
+        string checkpointName;
+        stream >> checkpointName;
+        action = arena.create<BackupSimulation>(checkpointName);
+    } else if (command == "restore") {
+        string checkpointName;
+        stream >> checkpointName;
+        action = arena.create<RestoreSimulation>(checkpointName);
+    } else if (command == "save") {
+        string path;
+        stream >> path;
+        action = arena.create<SaveSimulation>(path);
+    } else if (command == "load") {
+        string path;
+        stream >> path;
+        action = arena.create<LoadSimulation>(path);
+    } else if (command == "memory") {
+        action = arena.create<PrintMemoryUsage>();
+    } else if (command == "stats") {
+        action = arena.create<PrintStats>();
+    } else if (command == "close") {
+        action = arena.create<Close>();
+    } else {
+        throw runtime_error("Unknown command: " + command);
+    }
+    return action;
+}
+
+static void printCommandError(const string &line, const char *error) {
+    standardOutput().flush();
+    std::cerr << "Error processing command: " << line << "\n"
+              << error << "\n";
+}
+
+// Reads, runs and logs one command at a time
+void Simulation::runCommands() {
     while (isRunning) {
+        // Output is flushed before waiting for input, rather than after every line
+        if (cin.rdbuf()->in_avail() <= 0) {
+            standardOutput().flush();
+        }
         string line;
-        getline(cin, line);
+        if (!getline(cin, line)) {
+            close();
+            break;
+        }
         if (line.empty() || line[0] == '#') {
             continue; // Skip comments and empty lines
         }
 
-        istringstream stream(line);
-        string command;
-        stream >> command;
-
         try {
-            BaseAction *action = nullptr;
-
-            if (command == "step") {
-                int numOfSteps;
-                stream >> numOfSteps;
-                action = new SimulateStep(numOfSteps);
-            } else if (command == "plan") {
-                string settlementName, policyType;
-                stream >> settlementName >> policyType;
-                action = new AddPlan(settlementName, policyType);
-            } else if (command == "planStatus") {
-                int planId;
-                stream >> planId;
-                action = new PrintPlanStatus(planId);
-            } else if (command == "actionsLog") {
-                action = new PrintActionsLog();
-            } else if (command == "changePolicy") {
-                int planId;
-                string newPolicyType;
-                stream >> planId >> newPolicyType;
-                action = new ChangePlanPolicy(planId, newPolicyType);
-            } else {
-                throw runtime_error("Unknown command: " + command);
+            // The action runs from the command arena and is copied into the log once it is done
+            BaseAction *action = parseCommand(line, commandArena);
+            action->act(*this);
+            addAction(*action);
+        } catch (const std::exception &e) {
+            printCommandError(line, e.what());
+        }
+        commandArena.reset();
+    }
+}
+
+// A command read by the pipelined command loop
+struct PendingCommand {
+    PendingCommand(const string &line) : line(line), action(), error(), answered(false) {}
+    string line;
+    unique_ptr<BaseAction> action; //nullptr if the line couldn't be parsed
+    string error; //Why the line couldn't be parsed or run
+    bool answered; //Already run by the reader; only left to log
+};
+
+// Commands in input order, from the reader thread to the executor, and the snapshot of the
+// simulation the reader answers read-only commands from
+struct CommandQueue {
+    CommandQueue()
+        : mutex(), commandReady(), snapshotReady(), commands(), finished(false), snapshot(), snapshotWanted(false),
+          readerWaiting(false) {}
+    std::mutex mutex;
+    std::condition_variable commandReady; //Also wakes the executor when the reader waits for a snapshot
+    std::condition_variable snapshotReady;
+    std::deque<PendingCommand> commands;
+    bool finished; //The reader has stopped: end of input, or a close command
+    shared_ptr<Simulation> snapshot; //As of the last command run; nullptr if it was dropped
+    bool snapshotWanted; //The reader used snapshot since it was published
+    bool readerWaiting; //The reader waits for a snapshot; it can't be dropped until the reader has it
+};
+
+// Like runCommands, but a reader thread parses the input into a queue while this thread runs
+// the queued commands in order. Read-only commands are answered by the reader from a snapshot
+// of the simulation as of the last command run, so they don't wait behind a long step, and
+// are still logged in input order.
+//
+// A snapshot shares the plans, so the next step would have to copy every chunk of them. It is
+// only kept up to date while the reader uses it, and dropped after a command otherwise. A
+// read-only command that finds no snapshot has one published as soon as the command being run
+// ends, or at once if none is; only then does it wait for a step in progress.
+void Simulation::runCommandsPipelined() {
+    CommandQueue queue;
+    std::mutex outputMutex; //Keeps the output of the two threads from interleaving
+
+    std::thread reader([&] {
+        Arena parseArena(COMMAND_ARENA_BLOCK_SIZE);
+        string line;
+        bool closing = false;
+        while (!closing && getline(cin, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue; // Skip comments and empty lines
+            }
+            PendingCommand command(line);
+            try {
+                command.action.reset(parseCommand(line, parseArena)->clone());
+                closing = dynamic_cast<const Close *>(command.action.get()) != nullptr;
+                if (command.action->isReadOnly()) {
+                    shared_ptr<Simulation> snapshot;
+                    {
+                        unique_lock<std::mutex> lock(queue.mutex);
+                        if (!queue.snapshot) {
+                            queue.readerWaiting = true;
+                            queue.commandReady.notify_one();
+                            queue.snapshotReady.wait(lock, [&] { return queue.snapshot != nullptr; });
+                            queue.readerWaiting = false;
+                        }
+                        queue.snapshotWanted = true;
+                        snapshot = queue.snapshot;
+                    }
+                    lock_guard<std::mutex> outputLock(outputMutex);
+                    command.action->act(*snapshot);
+                    command.answered = true;
+                    if (cin.rdbuf()->in_avail() <= 0) {
+                        standardOutput().flush();
+                    }
+                }
+            } catch (const std::exception &e) {
+                command.action.reset();
+                command.error = e.what();
             }
+            parseArena.reset();
+            lock_guard<std::mutex> lock(queue.mutex);
+            queue.commands.push_back(std::move(command));
+            queue.commandReady.notify_one();
+        }
+        lock_guard<std::mutex> lock(queue.mutex);
+        queue.finished = true;
+        queue.commandReady.notify_one();
+    });
 
-            if (action) {
-                action->act(*this);
-                actionsLog.push_back(action);
+    auto publish = [&] {
+        shared_ptr<Simulation> copy = std::make_shared<Simulation>(*this);
+        lock_guard<std::mutex> lock(queue.mutex);
+        queue.snapshot.swap(copy);
+        queue.snapshotWanted = false;
+        queue.snapshotReady.notify_all();
+    };
+
+    while (isRunning) {
+        unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.commands.empty()) {
+            lock.unlock();
+            {
+                lock_guard<std::mutex> outputLock(outputMutex);
+                standardOutput().flush();
+            }
+            lock.lock();
+        }
+        queue.commandReady.wait(lock, [&] {
+            return queue.finished || !queue.commands.empty() || (queue.readerWaiting && !queue.snapshot);
+        });
+        if (queue.readerWaiting && !queue.snapshot) {
+            lock.unlock();
+            publish();
+            continue;
+        }
+        if (queue.commands.empty()) {
+            close();
+            break;
+        }
+        PendingCommand command = std::move(queue.commands.front());
+        queue.commands.pop_front();
+        lock.unlock();
+
+        if (command.action && !command.answered) {
+            try {
+                if (command.action->printsOutput()) {
+                    lock_guard<std::mutex> outputLock(outputMutex);
+                    command.action->act(*this);
+                } else {
+                    command.action->act(*this);
+                }
+            } catch (const std::exception &e) {
+                command.action.reset();
+                command.error = e.what();
             }
-        } catch (const std::exception &e) {
-            std::cerr << "Error processing command: " << line << "\n"
-                      << e.what() << "\n";
         }
+        if (!command.action) {
+            lock_guard<std::mutex> outputLock(outputMutex);
+            printCommandError(command.line, command.error.c_str());
+            continue;
+        }
+        addAction(*command.action);
+        // Even a read-only command changed the state: its log entry
+        shared_ptr<Simulation> stale;
+        lock.lock();
+        bool keepSnapshot = queue.snapshotWanted || queue.readerWaiting;
+        if (!keepSnapshot) {
+            stale.swap(queue.snapshot);
+        }
+        lock.unlock();
+        if (keepSnapshot) {
+            publish();
+        }
+    }
+    reader.join();
+}
+
+// Copies share the plans, settlements and facility options of other; see CowPointer
+Simulation::Simulation(const Simulation &other)
+    : isRunning(other.isRunning), planCounter(other.planCounter), currentTick(other.currentTick), actionsLog(other.actionsLog), plans(other.plans),
+      settlements(other.settlements), facilitiesOptions(other.facilitiesOptions),
+      stepPool(other.stepPool.getThreadCount()), schedule(), commandArena(COMMAND_ARENA_BLOCK_SIZE), checkpoints(), pipelined(false) {}
+
+Simulation &Simulation::operator=(const Simulation &other) {
+    if (this != &other) {
+        isRunning = other.isRunning;
+        planCounter = other.planCounter;
+        currentTick = other.currentTick;
+        actionsLog = other.actionsLog;
+        plans = other.plans;
+        settlements = other.settlements;
+        facilitiesOptions = other.facilitiesOptions;
+        schedule.clear();
     }
+    return *this;
+}
+
+Simulation::~Simulation() = default;
+
+void Simulation::addPlan(const Settlement *settlement, SelectionPolicy *selectionPolicy) {
+    plans.write().add(std::make_shared<Plan>(planCounter++, *settlement, selectionPolicy));
+    if (!schedule.empty()) {
+        reschedulePlan(plans->size() - 1);
+    }
+}
+
+void Simulation::addPlan(const string &settlementName, const string &selectionPolicy) {
+    const Settlement *settlement = getSettlement(settlementName);
+    if (!settlement) {
+        throw runtime_error("Settlement not found: " + settlementName);
+    }
+    addPlan(settlement, createPolicy(selectionPolicy));
+}
+
+void Simulation::addAction(const BaseAction &action) {
+    actionsLog.add(action);
+}
+
+// Takes ownership of settlement; returns false (and leaves it to the caller) if the name is taken
+bool Simulation::addSettlement(Settlement *settlement) {
+    if (isSettlementExists(settlement->getName())) {
+        return false;
+    }
+    SettlementTable &table = settlements.write();
+    table.ordered.emplace_back(settlement);
+    table.byName.emplace(settlement->getName(), settlement);
+    return true;
+}
+
+void Simulation::addSettlement(const string &settlementName, SettlementType settlementType) {
+    Settlement *settlement = new Settlement(settlementName, settlementType);
+    if (!addSettlement(settlement)) {
+        delete settlement;
+        throw runtime_error("Settlement already exists: " + settlementName);
+    }
+}
+
+bool Simulation::isSettlementExists(const string &settlementName) {
+    return settlements->byName.count(settlementName) != 0;
+}
+
+// Returns nullptr if there is no settlement with this name
+const Settlement *Simulation::getSettlement(const string &settlementName) const {
+    auto it = settlements->byName.find(settlementName);
+    return it == settlements->byName.end() ? nullptr : it->second;
+}
+
+const Plan &Simulation::getPlan(const int planID) const {
+    size_t index = plans->indexOf(planID);
+    if (index == string::npos) {
+        throw runtime_error("Plan doesn't exist: " + std::to_string(planID));
+    }
+    return plans->get(index);
+}
+
+// Like getPlan, but first gives this simulation its own copy of the plan if a backup shares it
+Plan &Simulation::getMutablePlan(const int planID) {
+    getPlan(planID);
+    PlanTable &table = plans.write();
+    return table.write(table.indexOf(planID));
+}
+
+void Simulation::getPlanStatus(const int planID) {
+    getPlan(planID).printStatus();
+}
+
+void Simulation::exportPlansStatus(const PlanQuery &query, PlanExportFormat format, const string &path) {
+    unique_ptr<SelectionPolicy> policy;
+    if (!query.policyType.empty()) {
+        policy.reset(createPolicy(query.policyType));
+    }
+    const PlanTable &planTable = *plans;
+    vector<const Plan *> selected;
+    selected.reserve(planTable.size());
+    for (size_t i = 0; i < planTable.size(); ++i) {
+        const Plan &plan = planTable.get(i);
+        if (plan.getPlanID() >= query.firstPlanId && plan.getPlanID() <= query.lastPlanId &&
+            (query.settlementType < 0 || static_cast<int>(plan.getSettlement().getType()) == query.settlementType) &&
+            (!policy || typeid(plan.getSelectionPolicy()) == typeid(*policy))) {
+            selected.push_back(&plan);
+        }
+    }
+
+    if (path.empty()) {
+        OutputWriter &out = standardOutput();
+        if (format == PlanExportFormat::COLUMNS) {
+            throw runtime_error("Columnar plan status needs a file");
+        }
+        if (out.getFormat() == OutputFormat::JSON) {
+            writePlanJson(out, selected);
+        } else {
+            writePlanCsv(out, selected);
+        }
+        return;
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Failed to open export file: " + path);
+    }
+    bool failed;
+    {
+        OutputWriter out(fd);
+        if (format == PlanExportFormat::COLUMNS) {
+            writePlanColumns(out, selected);
+        } else {
+            writePlanCsv(out, selected);
+        }
+        out.flush();
+        failed = out.hasFailed();
+    }
+    if (::close(fd) != 0 || failed) {
+        throw runtime_error("Failed to write export file: " + path);
+    }
+}
+
+void Simulation::changePlanPolicy(const int planID, const string &newPolicy) {
+    const Plan &plan = getPlan(planID);
+    SelectionPolicy *policy = createPolicy(newPolicy, plan.getLifeQualityScore(), plan.getEconomyScore(), plan.getEnvironmentScore());
+    if (typeid(*policy) == typeid(plan.getSelectionPolicy())) {
+        delete policy;
+        throw runtime_error("Plan already uses this selection policy");
+    }
+    getMutablePlan(planID).setSelectionPolicy(policy);
+    if (!schedule.empty()) {
+        reschedulePlan(plans->indexOf(planID));
+    }
+}
+
+// Scores the plan would have numOfSteps steps from now under each of policyTypes, without
+// changing this simulation. Plans don't depend on each other, so each branch is a copy of
+// the plan alone, which shares its facility history with the original; branches are
+// fast-forwarded in parallel, one per thread.
+vector<Simulation::PolicyOutcome> Simulation::comparePolicies(const int planID, int numOfSteps, const vector<string> &policyTypes) {
+    if (!isRunning) {
+        throw runtime_error("Cannot execute step. Simulation is not running.");
+    }
+    const Plan &plan = getPlan(planID);
+    Tick endTick = currentTick + std::max(numOfSteps, 0);
+    vector<PolicyOutcome> outcomes(policyTypes.size());
+    stepPool.parallelEach(policyTypes.size(), [&](size_t branchIndex, size_t) {
+        PlanTable branch;
+        branch.add(std::make_shared<Plan>(plan));
+        Plan &branchPlan = branch.write(0);
+        SelectionPolicy *policy = createPolicy(policyTypes[branchIndex], plan.getLifeQualityScore(),
+                                               plan.getEconomyScore(), plan.getEnvironmentScore());
+        bool isCurrent = typeid(*policy) == typeid(plan.getSelectionPolicy());
+        if (isCurrent) {
+            delete policy;
+        } else {
+            branchPlan.setSelectionPolicy(policy);
+        }
+        ScheduleShard branchSchedule(currentTick + 1);
+        schedulePlan(branchPlan, *facilitiesOptions, branchSchedule, 0, currentTick);
+        fastForward(branch, branchSchedule, 0, endTick);
+        PolicyOutcome &outcome = outcomes[branchIndex];
+        outcome.policyType = policyTypes[branchIndex];
+        outcome.isCurrent = isCurrent;
+        outcome.lifeQualityScore = branchPlan.getLifeQualityScore();
+        outcome.economyScore = branchPlan.getEconomyScore();
+        outcome.environmentScore = branchPlan.getEnvironmentScore();
+    });
+    return outcomes;
+}
+
+void Simulation::printActionsLog() const {
+    OutputWriter &out = standardOutput();
+    bool json = out.getFormat() == OutputFormat::JSON;
+    Arena actionArena(COMMAND_ARENA_BLOCK_SIZE);
+    for (size_t i = 0; i < actionsLog.size(); ++i) {
+        const BaseAction *action = actionsLog.get(i, actionArena);
+        const char *status = (action->getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR";
+        if (json) {
+            out << "{\"type\":\"action\",\"action\":";
+            out.writeJsonString(action->toString());
+            out << ",\"status\":\"" << status << "\"}\n";
+        } else {
+            out << action->toString() << ' ' << status << '\n';
+        }
+        actionArena.reset();
+    }
+}
+
+static void printArenaUsage(const char *label, const char *name, size_t objects, size_t bytesUsed, size_t bytesReserved) {
+    OutputWriter &out = standardOutput();
+    if (out.getFormat() == OutputFormat::JSON) {
+        out << "{\"type\":\"memory\",\"arena\":\"" << name << "\",\"objects\":" << objects
+            << ",\"bytesUsed\":" << bytesUsed << ",\"bytesReserved\":" << bytesReserved << "}\n";
+    } else {
+        out << label << ": " << objects << " objects, " << bytesUsed << " bytes used, "
+            << bytesReserved << " bytes reserved\n";
+    }
+}
+
+void Simulation::printMemoryUsage() const {
+    printArenaUsage("Actions log", "actionsLog", actionsLog.getRecordCount(), actionsLog.getBytesUsed(), actionsLog.getBytesReserved());
+    printArenaUsage("Actions log strings", "actionsLogStrings", actionsLog.getStringCount(), actionsLog.getStringBytes(), actionsLog.getStringBytes());
+    printArenaUsage("Command arena", "command", commandArena.getObjectCount(), commandArena.getBytesUsed(), commandArena.getBytesReserved());
+}
+
+// Keeps a copy of this simulation in the global backup slot, replacing the previous one.
+// The copy shares the state of this simulation, so only what changes afterwards is copied.
+void Simulation::backup() const {
+    Simulation *copy = new Simulation(*this);
+    delete ::backup;
+    ::backup = copy;
+}
+
+void Simulation::restore() {
+    if (::backup == nullptr) {
+        throw runtime_error("No backup available");
+    }
+    *this = *::backup;
+}
+
+// Keeps a copy of this simulation under checkpointName, replacing any checkpoint of that name.
+// Checkpoints share everything that hasn't changed between them and the simulation, so each
+// one only holds the plans, facility progress and actions log tail that differ from the rest.
+void Simulation::backup(const string &checkpointName) {
+    checkpoints[checkpointName] = std::make_shared<const Simulation>(*this);
+}
+
+void Simulation::restore(const string &checkpointName) {
+    auto it = checkpoints.find(checkpointName);
+    if (it == checkpoints.end()) {
+        throw runtime_error("No checkpoint named " + checkpointName);
+    }
+    *this = *it->second;
+}
+
+// Writes settlements, facility options, plans and the actions log to a binary snapshot at path.
+// Plans refer to their settlement by its position in the settlements section.
+void Simulation::saveSnapshot(const string &path) const {
+    SnapshotWriter writer;
+    writer.writeInt(planCounter);
+    writer.writeSize(static_cast<uint64_t>(currentTick));
+
+    const vector<shared_ptr<const Settlement>> &settlementList = settlements->ordered;
+    unordered_map<const Settlement *, size_t> settlementIndices;
+    settlementIndices.reserve(settlementList.size());
+    writer.writeSize(settlementList.size());
+    for (size_t i = 0; i < settlementList.size(); ++i) {
+        writer.writeString(settlementList[i]->getName());
+        writer.writeByte(static_cast<uint8_t>(settlementList[i]->getType()));
+        settlementIndices.emplace(settlementList[i].get(), i);
+    }
+
+    const vector<FacilityType> &facilityTypes = facilitiesOptions->getTypes();
+    writer.writeSize(facilityTypes.size());
+    for (const FacilityType &type : facilityTypes) {
+        writer.writeString(type.getName());
+        writer.writeByte(static_cast<uint8_t>(type.getCategory()));
+        writer.writeInt(type.getCost());
+        writer.writeInt(type.getLifeQualityScore());
+        writer.writeInt(type.getEconomyScore());
+        writer.writeInt(type.getEnvironmentScore());
+    }
+
+    writer.writeSize(plans->size());
+    for (size_t i = 0; i < plans->size(); ++i) {
+        const Plan &plan = plans->get(i);
+        writer.writeSize(settlementIndices.at(&plan.getSettlement()));
+        plan.save(writer);
+    }
+
+    actionsLog.save(writer);
+    writer.save(path);
+}
+
+// Replaces the state of this simulation with a snapshot written by saveSnapshot. The snapshot
+// is read and checked in full before anything is replaced, so a bad file leaves it unchanged.
+void Simulation::loadSnapshot(const string &path) {
+    SnapshotReader reader(path);
+    int loadedPlanCounter = reader.readInt();
+    Tick loadedTick = static_cast<Tick>(reader.readSize());
+    if (loadedTick < 0) {
+        throw runtime_error("Invalid tick in snapshot");
+    }
+    shared_ptr<SettlementTable> loadedSettlements = std::make_shared<SettlementTable>();
+    shared_ptr<FacilityCatalog> loadedCatalog = std::make_shared<FacilityCatalog>();
+    shared_ptr<PlanTable> loadedPlans = std::make_shared<PlanTable>();
+    ActionsLog loadedLog;
+
+    size_t settlementCount = reader.readCount(sizeof(uint64_t) + 1);
+    loadedSettlements->ordered.reserve(settlementCount);
+    loadedSettlements->byName.reserve(settlementCount);
+    for (size_t i = 0; i < settlementCount; ++i) {
+        string name = reader.readString();
+        uint8_t type = reader.readByte();
+        if (type > static_cast<uint8_t>(SettlementType::METROPOLIS)) {
+            throw runtime_error("Invalid settlement in snapshot");
+        }
+        loadedSettlements->ordered.push_back(std::make_shared<const Settlement>(name, static_cast<SettlementType>(type)));
+        if (!loadedSettlements->byName.emplace(name, loadedSettlements->ordered.back().get()).second) {
+            throw runtime_error("Duplicate settlement in snapshot");
+        }
+    }
+
+    size_t facilityCount = reader.readCount(sizeof(uint64_t) + 1 + 4 * sizeof(int32_t));
+    for (size_t i = 0; i < facilityCount; ++i) {
+        string name = reader.readString();
+        uint8_t category = reader.readByte();
+        int price = reader.readInt();
+        int lifeQualityScore = reader.readInt();
+        int economyScore = reader.readInt();
+        int environmentScore = reader.readInt();
+        if (category > static_cast<uint8_t>(FacilityCategory::ENVIRONMENT) ||
+            loadedCatalog->add(FacilityType(name, static_cast<FacilityCategory>(category), price, lifeQualityScore, economyScore, environmentScore)) == FacilityCatalog::NO_FACILITY) {
+            throw runtime_error("Invalid facility type in snapshot");
+        }
+    }
+
+    size_t planCount = reader.readCount(2 * sizeof(uint64_t));
+    loadedPlans->reserve(planCount);
+    for (size_t i = 0; i < planCount; ++i) {
+        uint64_t settlementIndex = reader.readSize();
+        if (settlementIndex >= settlementCount) {
+            throw runtime_error("Invalid plan in snapshot");
+        }
+        shared_ptr<Plan> plan = std::make_shared<Plan>(reader, *loadedSettlements->ordered[settlementIndex], *loadedCatalog, loadedTick);
+        int planId = plan->getPlanID();
+        if (planId < 0 || planId >= loadedPlanCounter || loadedPlans->indexOf(planId) != string::npos) {
+            throw runtime_error("Invalid plan in snapshot");
+        }
+        loadedPlans->add(plan);
+    }
+
+    loadedLog.setLimit(actionsLog.getLimit());
+    loadedLog.load(reader);
+    if (!reader.atEnd()) {
+        throw runtime_error("Unexpected data at the end of the snapshot");
+    }
+
+    planCounter = loadedPlanCounter;
+    currentTick = loadedTick;
+    settlements = CowPointer<SettlementTable>(loadedSettlements);
+    facilitiesOptions = CowPointer<FacilityCatalog>(loadedCatalog);
+    plans = CowPointer<PlanTable>(loadedPlans);
+    actionsLog = loadedLog;
+    schedule.clear();
+}
+
+SelectionPolicy *Simulation::createPolicy(const string &policyType, int lifeQualityScore, int economyScore, int environmentScore) {
+    if (policyType == "nve") {
+        return new NaiveSelection();
+    }
+    if (policyType == "bal") {
+        return new BalancedSelection(lifeQualityScore, economyScore, environmentScore);
+    }
+    if (policyType == "eco") {
+        return new EconomySelection();
+    }
+    if (policyType == "env") {
+        return new SustainabilitySelection();
+    }
+    throw runtime_error("Unknown selection policy: " + policyType);
 }
 
-// Remaining methods (unchanged)...
 
 // Executes one step
 void Simulation::step() {
+    step(1);
+}
+
+// Executes numOfSteps steps. Plans don't depend on each other, so every shard of the
+// schedule is fast-forwarded on its own thread: a plan only runs Plan::step on the ticks
+// where it starts or finishes a facility, and the ticks in between are skipped at once.
+void Simulation::step(int numOfSteps) {
+    INSTRUMENT_SCOPE("Simulation::step");
     if (!isRunning) {
         throw runtime_error("Cannot execute step. Simulation is not running.");
     }
-    for (auto &plan : plans) {
-        plan.step();
+    if (numOfSteps <= 0) {
+        return;
+    }
+    if (schedule.empty()) {
+        buildSchedule();
+    }
+    Tick endTick = currentTick + numOfSteps;
+    // Detached here, before the workers start; each worker then only writes the plans of
+    // its own shards
+    PlanTable &planTable = plans.write();
+    stepPool.parallelEach(schedule.size(), [this, &planTable, endTick](size_t shard, size_t) {
+        fastForward(planTable, schedule[shard], shard * SCHEDULE_SHARD_SIZE, endTick);
+    });
+    currentTick = endTick;
+}
+
+// Puts plan, which is item in shard, where its next event after tick now is due: the active
+// plans if it is the next tick, the parked ones if it is a later one, and nowhere if it has
+// none, as then it has nothing to do until a command changes it
+void Simulation::schedulePlan(const Plan &plan, const FacilityCatalog &catalog, ScheduleShard &shard, size_t item, Tick now) {
+    int idleSteps = plan.stepsUntilEvent(catalog, now);
+    if (idleSteps == 0) {
+        shard.active.push_back(item);
+    } else if (idleSteps != Plan::NO_EVENT) {
+        shard.parked.schedule(item, now + idleSteps + 1);
     }
 }
 
+// Works out the next event of every plan afresh
+void Simulation::buildSchedule() {
+    const PlanTable &planTable = *plans;
+    const FacilityCatalog &catalog = *facilitiesOptions;
+    size_t shardCount = (planTable.size() + SCHEDULE_SHARD_SIZE - 1) / SCHEDULE_SHARD_SIZE;
+    schedule.assign(shardCount, ScheduleShard(currentTick + 1));
+    stepPool.parallelEach(shardCount, [this, &planTable, &catalog](size_t shard, size_t) {
+        size_t first = shard * SCHEDULE_SHARD_SIZE;
+        size_t end = std::min(first + SCHEDULE_SHARD_SIZE, planTable.size());
+        for (size_t planIndex = first; planIndex < end; ++planIndex) {
+            schedulePlan(planTable.get(planIndex), catalog, schedule[shard], planIndex - first, currentTick);
+        }
+    });
+}
+
+// For a plan that is new or was changed between steps, while the schedule is kept
+void Simulation::reschedulePlan(size_t planIndex) {
+    if (planIndex / SCHEDULE_SHARD_SIZE == schedule.size()) {
+        schedule.push_back(ScheduleShard(currentTick + 1));
+    }
+    ScheduleShard &shard = schedule[planIndex / SCHEDULE_SHARD_SIZE];
+    size_t item = planIndex % SCHEDULE_SHARD_SIZE;
+    shard.active.erase(std::remove(shard.active.begin(), shard.active.end(), item), shard.active.end());
+    shard.parked.cancel(item);
+    schedulePlan(plans->get(planIndex), *facilitiesOptions, shard, item, currentTick);
+}
+
+// Event loop over the plans of one shard, the ones from firstPlan on, up to endTick. Active
+// plans are stepped at every tick until they fill their slots or run out of facilities to
+// select, and are parked then; parked plans are left alone until they are due. While no plan
+// is active, the ticks up to the next parked one are skipped at once. A plan is only written
+// to (and copied, if a backup shares it) on the ticks it is stepped.
+void Simulation::fastForward(PlanTable &planTable, ScheduleShard &shard, size_t firstPlan, Tick endTick) {
+    INSTRUMENT_SCOPE("Simulation::fastForward");
+    const FacilityCatalog &catalog = *facilitiesOptions;
+    vector<size_t> resumed; //Parked plans due at tick
+    Tick tick = currentTick + 1;
+    while (tick <= endTick) {
+        if (shard.active.empty()) {
+            if (!shard.parked.popDue(endTick, tick, resumed)) {
+                break;
+            }
+        } else {
+            Tick dueTick;
+            shard.parked.popDue(tick, dueTick, resumed);
+        }
+        // Active plans first, as resumed ones may join them for the next tick
+        size_t kept = 0;
+        for (size_t item : shard.active) {
+            Plan &plan = planTable.write(firstPlan + item);
+            plan.step(catalog, tick);
+            int idleSteps = plan.stepsUntilEvent(catalog, tick);
+            if (idleSteps == 0) {
+                shard.active[kept++] = item;
+            } else if (idleSteps != Plan::NO_EVENT) {
+                shard.parked.schedule(item, tick + idleSteps + 1);
+            }
+        }
+        shard.active.resize(kept);
+        for (size_t item : resumed) {
+            Plan &plan = planTable.write(firstPlan + item);
+            plan.step(catalog, tick);
+            schedulePlan(plan, catalog, shard, item, tick);
+        }
+        ++tick;
+    }
+}
+
+void Simulation::setThreadCount(int threadCount) {
+    if (threadCount < 1) {
+        throw runtime_error("Thread count must be positive");
+    }
+    stepPool.setThreadCount(threadCount);
+}
+
+// Keeps only the last limit actions in the log; 0 keeps every action
+void Simulation::setActionsLogLimit(size_t limit) {
+    actionsLog.setLimit(limit);
+}
+
+// With pipelining on, start() reads commands on a thread of their own and answers read-only
+// ones at once, from a copy of the simulation as of the last command that finished
+void Simulation::setPipelined(bool pipelined) {
+    this->pipelined = pipelined;
+}
+
 // Starts the simulation
 void Simulation::open() {
     if (isRunning) {
@@ -0,0 +1,155 @@
+#include "Snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+static const char SNAPSHOT_MAGIC[8] = {'S', 'I', 'M', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t SNAPSHOT_VERSION = 3;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const size_t HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + sizeof(SNAPSHOT_VERSION) + sizeof(BYTE_ORDER_MARK);
+
+SnapshotWriter::SnapshotWriter() : buffer() {
+    writeBytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writeBytes(&SNAPSHOT_VERSION, sizeof(SNAPSHOT_VERSION));
+    writeBytes(&BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK));
+}
+
+void SnapshotWriter::writeBytes(const void *data, size_t length) {
+    const char *bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+void SnapshotWriter::writeByte(uint8_t value) {
+    buffer.push_back(static_cast<char>(value));
+}
+
+void SnapshotWriter::writeInt(int32_t value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::writeSize(uint64_t value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::writeString(const string &value) {
+    writeSize(value.size());
+    writeBytes(value.data(), value.size());
+}
+
+void SnapshotWriter::save(const string &path) const {
+    string temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Failed to open snapshot file: " + path);
+    }
+    // A single write normally covers the whole buffer; the loop only handles short writes
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            ::close(fd);
+            std::remove(temporaryPath.c_str());
+            throw runtime_error("Failed to write snapshot file: " + path);
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (::close(fd) != 0 || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        throw runtime_error("Failed to write snapshot file: " + path);
+    }
+}
+
+SnapshotReader::SnapshotReader(const string &path) : data(nullptr), size(0), position(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Failed to open snapshot file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw runtime_error("Failed to open snapshot file: " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw runtime_error("Failed to open snapshot file: " + path);
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+    }
+    ::close(fd);
+
+    uint32_t version = 0, byteOrderMark = 0;
+    if (size >= HEADER_SIZE) {
+        std::memcpy(&version, data + sizeof(SNAPSHOT_MAGIC), sizeof(version));
+        std::memcpy(&byteOrderMark, data + sizeof(SNAPSHOT_MAGIC) + sizeof(version), sizeof(byteOrderMark));
+    }
+    if (size < HEADER_SIZE || std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        munmap(const_cast<char *>(data), size);
+        throw runtime_error("Not a snapshot file: " + path);
+    }
+    if (version != SNAPSHOT_VERSION || byteOrderMark != BYTE_ORDER_MARK) {
+        munmap(const_cast<char *>(data), size);
+        throw runtime_error("Unsupported snapshot format: " + path);
+    }
+    position = HEADER_SIZE;
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+    }
+}
+
+const char *SnapshotReader::take(size_t length) {
+    if (length > size - position) {
+        throw runtime_error("Truncated snapshot");
+    }
+    const char *bytes = data + position;
+    position += length;
+    return bytes;
+}
+
+uint8_t SnapshotReader::readByte() {
+    return static_cast<uint8_t>(*take(1));
+}
+
+int32_t SnapshotReader::readInt() {
+    int32_t value;
+    readArray(&value, 1);
+    return value;
+}
+
+uint64_t SnapshotReader::readSize() {
+    uint64_t value;
+    readArray(&value, 1);
+    return value;
+}
+
+string SnapshotReader::readString() {
+    size_t length = readCount(1);
+    return string(take(length), length);
+}
+
+size_t SnapshotReader::readCount(size_t minItemSize) {
+    uint64_t count = readSize();
+    if (count > (size - position) / minItemSize) {
+        throw runtime_error("Truncated snapshot");
+    }
+    return static_cast<size_t>(count);
+}
+
+bool SnapshotReader::atEnd() const {
+    return position == size;
+}
@@ -0,0 +1,39 @@
+#include "StringPool.h"
+#include <stdexcept>
+
+const uint32_t StringPool::EMPTY;
+
+StringPool::StringPool() : mutex(), strings(), ids(), bytesUsed(0) {
+    intern("");
+}
+
+uint32_t StringPool::intern(const string &text) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ids.find(&text);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.push_back(text);
+    ids.emplace(&strings.back(), id);
+    bytesUsed += text.size();
+    return id;
+}
+
+const string &StringPool::get(uint32_t id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id >= strings.size()) {
+        throw std::out_of_range("Unknown string ID");
+    }
+    return strings[id];
+}
+
+size_t StringPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.size();
+}
+
+size_t StringPool::getBytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesUsed;
+}
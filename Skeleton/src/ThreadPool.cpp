@@ -0,0 +1,149 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <stdexcept>
+
+using std::lock_guard;
+using std::unique_lock;
+
+// Chunks smaller than this are not worth waking a worker for.
+static const size_t MIN_CHUNK_SIZE = 64;
+// Chunks per thread, so a thread that finishes early can pick up more work.
+static const size_t CHUNKS_PER_THREAD = 4;
+
+// Workers are started by the first job that needs them, so pools that never run one
+// (such as the one of a backup) don't cost any threads
+ThreadPool::ThreadPool(int threadCount)
+    : threadCount(threadCount < 1 ? 1 : threadCount), workers(), stateMutex(), wakeWorkers(), jobDone(), job(nullptr),
+      jobSize(0), chunkSize(0), nextChunk(0), pendingWorkers(0), generation(0), stopping(false), failure() {}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+int ThreadPool::getThreadCount() const {
+    return threadCount;
+}
+
+void ThreadPool::setThreadCount(int threadCount) {
+    if (threadCount < 1) {
+        throw std::invalid_argument("Thread count must be positive");
+    }
+    if (threadCount == this->threadCount) {
+        return;
+    }
+    stopWorkers();
+    this->threadCount = threadCount;
+}
+
+int ThreadPool::defaultThreadCount() {
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads == 0 ? 1 : static_cast<int>(hardwareThreads);
+}
+
+void ThreadPool::startWorkers() {
+    stopping = false;
+    for (int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, generation);
+    }
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)> &task, size_t grain) {
+    size_t threads = static_cast<size_t>(threadCount);
+    if (threads == 1 || count < 2 * MIN_CHUNK_SIZE) {
+        if (count > 0) {
+            task(0, count);
+        }
+        return;
+    }
+    size_t size = std::max(MIN_CHUNK_SIZE, count / (threads * CHUNKS_PER_THREAD));
+    runJob(count, (size + grain - 1) / grain * grain, task);
+}
+
+void ThreadPool::parallelEach(size_t count, const std::function<void(size_t, size_t)> &task) {
+    if (threadCount == 1 || count < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i, i + 1);
+        }
+        return;
+    }
+    runJob(count, 1, task);
+}
+
+// Runs task on chunks of `size` items, on the workers and the calling thread
+void ThreadPool::runJob(size_t count, size_t size, const std::function<void(size_t, size_t)> &task) {
+    if (workers.empty()) {
+        startWorkers();
+    }
+
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        job = &task;
+        jobSize = count;
+        chunkSize = size;
+        nextChunk = 0;
+        pendingWorkers = workers.size();
+        failure = nullptr;
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+    runChunks();
+
+    unique_lock<std::mutex> lock(stateMutex);
+    jobDone.wait(lock, [this] { return pendingWorkers == 0; });
+    job = nullptr;
+    if (failure) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned long seenGeneration) {
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(stateMutex);
+            wakeWorkers.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+        runChunks();
+        {
+            lock_guard<std::mutex> lock(stateMutex);
+            if (--pendingWorkers == 0) {
+                jobDone.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runChunks() {
+    while (true) {
+        size_t begin = nextChunk.fetch_add(chunkSize);
+        if (begin >= jobSize) {
+            return;
+        }
+        size_t end = std::min(begin + chunkSize, jobSize);
+        try {
+            (*job)(begin, end);
+        } catch (...) {
+            lock_guard<std::mutex> lock(stateMutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#include "TimingWheel.h"
+#include <algorithm>
+#include <stdexcept>
+
+const size_t TimingWheel::SLOT_BITS;
+const size_t TimingWheel::SLOTS;
+const size_t TimingWheel::LEVELS;
+
+static const uint64_t SLOT_MASK = TimingWheel::SLOTS - 1;
+static const size_t HORIZON_BITS = TimingWheel::SLOT_BITS * TimingWheel::LEVELS; //Ticks the levels cover
+
+static size_t lowestBit(uint64_t bits) {
+    return static_cast<size_t>(__builtin_ctzll(bits));
+}
+
+TimingWheel::TimingWheel(Tick time) : time(time), slots(LEVELS * SLOTS), occupied(), overflow(), versions() {}
+
+void TimingWheel::schedule(size_t item, Tick due) {
+    if (due < time) {
+        throw std::logic_error("Cannot schedule an item before the wheel's time");
+    }
+    if (item >= versions.size()) {
+        versions.resize(item + 1, 0);
+    }
+    place(Entry{static_cast<uint32_t>(item), ++versions[item], due});
+}
+
+void TimingWheel::cancel(size_t item) {
+    if (item < versions.size()) {
+        ++versions[item];
+    }
+}
+
+bool TimingWheel::isCurrent(const Entry &entry) const {
+    return entry.version == versions[entry.item];
+}
+
+// At the level of the highest digit in which entry.due differs from time
+void TimingWheel::place(const Entry &entry) {
+    uint64_t difference = static_cast<uint64_t>(entry.due) ^ static_cast<uint64_t>(time);
+    if (difference >> HORIZON_BITS != 0) {
+        overflow.push_back(entry);
+        return;
+    }
+    size_t level = difference == 0 ? 0 : (63 - static_cast<size_t>(__builtin_clzll(difference))) / SLOT_BITS;
+    size_t slot = static_cast<size_t>(static_cast<uint64_t>(entry.due) >> (level * SLOT_BITS) & SLOT_MASK);
+    slots[level * SLOTS + slot].push_back(entry);
+    occupied[level] |= uint64_t(1) << slot;
+}
+
+// Sets time to newTime, which no entry is due before. The entries of every slot newTime enters
+// move down to the level where they belong from then on, and so do overflow entries that are
+// now within reach.
+void TimingWheel::moveTo(Tick newTime) {
+    uint64_t from = static_cast<uint64_t>(time), to = static_cast<uint64_t>(newTime);
+    time = newTime;
+    if (from >> HORIZON_BITS != to >> HORIZON_BITS && !overflow.empty()) {
+        vector<Entry> waiting;
+        waiting.swap(overflow);
+        for (const Entry &entry : waiting) {
+            if (isCurrent(entry)) {
+                place(entry);
+            }
+        }
+    }
+    for (size_t level = LEVELS - 1; level > 0; --level) {
+        size_t shift = level * SLOT_BITS;
+        size_t slot = static_cast<size_t>(to >> shift & SLOT_MASK);
+        if (from >> shift == to >> shift || (occupied[level] & uint64_t(1) << slot) == 0) {
+            continue;
+        }
+        occupied[level] &= ~(uint64_t(1) << slot);
+        vector<Entry> &entries = slots[level * SLOTS + slot];
+        for (const Entry &entry : entries) {
+            if (isCurrent(entry)) {
+                place(entry); //At a lower level: its digit at this level is now time's
+            }
+        }
+        entries.clear();
+    }
+}
+
+// First tick of the next nonempty slot above level 0, or of the earliest overflow entry; -1 if
+// nothing is left. Lower levels come first, as their slots all start before those above them.
+Tick TimingWheel::nextSlotStart() {
+    uint64_t now = static_cast<uint64_t>(time);
+    for (size_t level = 1; level < LEVELS; ++level) {
+        size_t shift = level * SLOT_BITS;
+        size_t slot = static_cast<size_t>(now >> shift & SLOT_MASK);
+        uint64_t later = slot == SLOTS - 1 ? 0 : occupied[level] & (~uint64_t(0) << (slot + 1));
+        if (later != 0) {
+            uint64_t span = now >> (shift + SLOT_BITS) << (shift + SLOT_BITS);
+            return static_cast<Tick>(span | static_cast<uint64_t>(lowestBit(later)) << shift);
+        }
+    }
+    overflow.erase(std::remove_if(overflow.begin(), overflow.end(), [this](const Entry &entry) {
+        return !isCurrent(entry);
+    }), overflow.end());
+    Tick earliest = -1;
+    for (const Entry &entry : overflow) {
+        if (earliest < 0 || entry.due < earliest) {
+            earliest = entry.due;
+        }
+    }
+    return earliest;
+}
+
+bool TimingWheel::popDue(Tick limit, Tick &tick, vector<size_t> &due) {
+    due.clear();
+    while (time <= limit) {
+        uint64_t ahead = occupied[0] & (~uint64_t(0) << (static_cast<uint64_t>(time) & SLOT_MASK));
+        if (ahead == 0) {
+            // Nothing more in level 0's span: on to where the next slot above it starts
+            Tick next = nextSlotStart();
+            if (next < 0 || next > limit) {
+                break;
+            }
+            moveTo(next);
+            continue;
+        }
+        size_t slot = lowestBit(ahead);
+        Tick next = static_cast<Tick>(static_cast<uint64_t>(time) & ~SLOT_MASK) + static_cast<Tick>(slot);
+        if (next > limit) {
+            break;
+        }
+        time = next;
+        occupied[0] &= ~(uint64_t(1) << slot);
+        vector<Entry> &entries = slots[slot];
+        for (const Entry &entry : entries) {
+            if (isCurrent(entry)) {
+                due.push_back(entry.item);
+            }
+        }
+        entries.clear();
+        if (!due.empty()) {
+            tick = next;
+            return true;
+        }
+    }
+    if (time <= limit) {
+        moveTo(limit + 1);
+    }
+    return false;
+}
+
+Tick TimingWheel::getTime() const {
+    return time;
+}
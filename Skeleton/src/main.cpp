@@ -10,6 +10,8 @@ int main(int argc, char** argv){
         cout << "usage: simulation <config_path>" << endl;
         return 0;
     }
+    // Output goes through standardOutput(); unsynced, cin reads ahead so it can tell when input is waiting
+    ios::sync_with_stdio(false);
     string configurationFile = argv[1];
     Simulation simulation(configurationFile);
     simulation.start();
@@ -0,0 +1,219 @@
+#include "Simulation.h"
+#include "../bench/Workload.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+Simulation* backup = nullptr;
+
+static const int SESSIONS = 40;
+static const int COMMANDS_PER_SESSION = 120;
+static const int TRACKED_PLANS = 6; //planStatus asks about plans 0 to TRACKED_PLANS - 1
+static const int TIMEOUT_SECONDS = 20;
+
+// A line of a session, and the delay before it is written in microseconds
+struct SessionLine {
+    string command;
+    int delay;
+    bool readOnly;
+};
+
+// Mutating commands interleaved with planStatus queries, paced so the reader sometimes runs
+// ahead of a step and sometimes waits on an idle executor
+static vector<SessionLine> randomSession(unsigned seed, const WorkloadShape &shape) {
+    std::mt19937 random(seed);
+    auto uniform = [&](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(random);
+    };
+    const char *policies[] = {"nve", "bal", "eco", "env"};
+    vector<SessionLine> session;
+    for (int i = 0; i < COMMANDS_PER_SESSION; ++i) {
+        std::ostringstream command;
+        bool readOnly = false;
+        int kind = uniform(0, 19);
+        if (kind < 8) {
+            command << "planStatus " << uniform(0, TRACKED_PLANS - 1);
+            readOnly = true;
+        } else if (kind < 13) {
+            command << "step " << (uniform(0, 4) == 0 ? uniform(50, 300) : uniform(1, 3));
+        } else if (kind < 15) {
+            command << "plan Settlement" << uniform(0, shape.settlements - 1) << " " << policies[uniform(0, 3)];
+        } else if (kind < 16) {
+            command << "changePolicy " << uniform(0, TRACKED_PLANS - 1) << " " << policies[uniform(0, 3)];
+        } else if (kind < 17) {
+            command << "facility Extra" << i << " " << uniform(0, 2) << " " << uniform(1, shape.maxCost) << " "
+                    << uniform(0, 5) << " " << uniform(0, 5) << " " << uniform(0, 5);
+        } else if (kind < 18) {
+            command << "backup";
+        } else {
+            command << "restore";
+        }
+        int delay = uniform(0, 2) == 0 ? 0 : uniform(0, 3000);
+        session.push_back(SessionLine{command.str(), delay, readOnly});
+    }
+    return session;
+}
+
+// Runs the simulation on configPath in a child process, feeding it the session through a pipe;
+// false if it didn't finish within TIMEOUT_SECONDS
+static bool runSession(const string &configPath, const vector<SessionLine> &session, const string &outputPath) {
+    int input[2];
+    if (pipe(input) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(input[1]);
+        dup2(input[0], STDIN_FILENO);
+        close(input[0]);
+        int output = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(output, STDOUT_FILENO);
+        close(output);
+        int errors = open("/dev/null", O_WRONLY);
+        dup2(errors, STDERR_FILENO);
+        close(errors);
+        ios::sync_with_stdio(false);
+        Simulation simulation(configPath);
+        simulation.start();
+        exit(0);
+    }
+    close(input[0]);
+    for (const SessionLine &line : session) {
+        if (line.delay > 0) {
+            usleep(line.delay);
+        }
+        string text = line.command + "\n";
+        if (write(input[1], text.data(), text.size()) != static_cast<ssize_t>(text.size())) {
+            break;
+        }
+    }
+    close(input[1]);
+
+    int status = 0;
+    for (int waited = 0; waited < TIMEOUT_SECONDS * 100; ++waited) {
+        if (waitpid(child, &status, WNOHANG) == child) {
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        usleep(10000);
+    }
+    kill(child, SIGKILL);
+    waitpid(child, &status, 0);
+    return false;
+}
+
+// The planStatus blocks of an output file, in order, each with the id of its plan; error lines
+// of other commands are skipped
+static vector<pair<int, string>> statusBlocks(const string &outputPath) {
+    ifstream in(outputPath);
+    vector<pair<int, string>> blocks;
+    string line;
+    int blockLines = 0; //Left in the current block; the status line and three scores
+    while (getline(in, line)) {
+        if (line.compare(0, 8, "PlanID: ") == 0) {
+            blocks.push_back(make_pair(atoi(line.c_str() + 8), ""));
+            blockLines = 4;
+        }
+        if (blockLines > 0) {
+            blocks.back().second += line + "\n";
+            --blockLines;
+        }
+    }
+    return blocks;
+}
+
+static string configWith(const string &workload, bool pipelined) {
+    string path = workload + (pipelined ? ".pipelined" : ".sequential");
+    ifstream in(workload);
+    ofstream out(path);
+    out << in.rdbuf() << "threads 2\npipeline " << (pipelined ? 1 : 0) << "\n";
+    return path;
+}
+
+// Each planStatus of the pipelined run must show its plan as of some command of the session,
+// so it has to be one of the states the sequential run prints after every command
+static bool checkSession(unsigned seed, const string &sequentialConfig, const string &pipelinedConfig,
+                         const WorkloadShape &shape) {
+    vector<SessionLine> session = randomSession(seed, shape);
+    vector<SessionLine> allStates;
+    auto addStatuses = [&] {
+        for (int plan = 0; plan < TRACKED_PLANS; ++plan) {
+            allStates.push_back(SessionLine{"planStatus " + to_string(plan), 0, true});
+        }
+    };
+    addStatuses();
+    size_t queries = 0;
+    for (const SessionLine &line : session) {
+        if (line.readOnly) {
+            ++queries;
+            continue;
+        }
+        allStates.push_back(SessionLine{line.command, 0, false});
+        addStatuses();
+    }
+
+    string outputPath = pipelinedConfig + ".out";
+    if (!runSession(sequentialConfig, allStates, outputPath)) {
+        cerr << "session " << seed << ": the sequential run failed" << endl;
+        return false;
+    }
+    map<int, set<string>> states;
+    for (const pair<int, string> &block : statusBlocks(outputPath)) {
+        states[block.first].insert(block.second);
+    }
+
+    if (!runSession(pipelinedConfig, session, outputPath)) {
+        cerr << "session " << seed << ": the pipelined run hung or failed" << endl;
+        return false;
+    }
+    vector<pair<int, string>> answers = statusBlocks(outputPath);
+    std::remove(outputPath.c_str());
+    if (answers.size() != queries) {
+        cerr << "session " << seed << ": " << answers.size() << " planStatus answers for " << queries
+             << " queries" << endl;
+        return false;
+    }
+    for (const pair<int, string> &answer : answers) {
+        if (states[answer.first].count(answer.second) == 0) {
+            cerr << "session " << seed << ": plan " << answer.first << " in a state no command left it in:\n"
+                 << answer.second;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    WorkloadShape shape;
+    shape.plans = 2000;
+    shape.settlements = 200;
+    string workload = temporaryWorkload(shape);
+    string sequentialConfig = configWith(workload, false);
+    string pipelinedConfig = configWith(workload, true);
+
+    int failures = 0;
+    for (int seed = 1; seed <= SESSIONS; ++seed) {
+        if (!checkSession(seed, sequentialConfig, pipelinedConfig, shape)) {
+            ++failures;
+        }
+    }
+    std::remove(workload.c_str());
+    std::remove(sequentialConfig.c_str());
+    std::remove(pipelinedConfig.c_str());
+    cerr << SESSIONS - failures << " of " << SESSIONS << " pipelined sessions passed" << endl;
+    return failures == 0 ? 0 : 1;
+}